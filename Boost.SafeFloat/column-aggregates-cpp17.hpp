@@ -0,0 +1,362 @@
+#ifndef COLUMN_AGGREGATES_CPP17_HPP
+#define COLUMN_AGGREGATES_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+
+
+namespace test
+{
+    /*
+     * Aggregates kept up to date while a column is modified, instead of recomputed over the
+     * whole column :
+     *   test::observed_column<int> column(test::get_vector<int>(tv));
+     *   auto& low = column.attach<test::min_observer<int>>();
+     *   column.push_back(3); column.set(0, 7); column.erase(1);
+     *   low.value();    // O(1)
+     * The column stays a std::vector<T> (it can be the one of a tuple of vectors), mutations made
+     * through observed_column are forwarded to the observers. Modifications made directly on
+     * the vector aren't seen, resync() recomputes everything after them.
+     * Observers see rows through slots : a slot is given to a row when it is appended and is
+     * kept when rows before it are erased, so erasing a row is O(log N) for the observers (the
+     * vector itself still moves the following elements). Slots are renumbered when too many of
+     * them are free or when they run out, which is amortized over the mutations.
+     */
+    template<typename T>
+    class column_observer
+    {
+    public:
+        virtual ~column_observer() = default;
+
+        virtual void on_insert(std::size_t slot, const T& value) = 0;
+        virtual void on_update(std::size_t slot, const T& old_value, const T& new_value) = 0;
+        virtual void on_erase(std::size_t slot, const T& old_value) = 0;
+        // Slots were renumbered : values[i] is in slot i and there are capacity slots
+        virtual void on_rebuild(const std::vector<T>& values, std::size_t capacity) = 0;
+    };
+
+
+    template<typename T, typename R = T>
+    class sum_observer : public column_observer<T>
+    {
+    public:
+        R value() const
+        {
+            return sum_;
+        }
+
+        void on_insert(std::size_t, const T& value) override
+        {
+            sum_ += static_cast<R>(value);
+        }
+
+        void on_update(std::size_t, const T& old_value, const T& new_value) override
+        {
+            sum_ += static_cast<R>(new_value) - static_cast<R>(old_value);
+        }
+
+        void on_erase(std::size_t, const T& old_value) override
+        {
+            sum_ -= static_cast<R>(old_value);
+        }
+
+        // Also resets the rounding errors accumulated by floating point sums
+        void on_rebuild(const std::vector<T>& values, std::size_t) override
+        {
+            sum_ = R{};
+            for(const auto& v : values)
+                sum_ += static_cast<R>(v);
+        }
+
+    private:
+        R sum_{};
+    };
+
+
+    namespace detail
+    {
+        struct always_true
+        {
+            template<typename T>
+            constexpr bool operator()(const T&) const
+            {
+                return true;
+            }
+        };
+    }
+
+    // Number of rows satisfying a predicate (every row by default)
+    template<typename T, typename Predicate = detail::always_true>
+    class count_observer : public column_observer<T>
+    {
+    public:
+        explicit count_observer(Predicate pred = Predicate{})
+            : pred_(std::move(pred))
+        {}
+
+        std::size_t value() const
+        {
+            return count_;
+        }
+
+        void on_insert(std::size_t, const T& value) override
+        {
+            count_ += pred_(value);
+        }
+
+        void on_update(std::size_t, const T& old_value, const T& new_value) override
+        {
+            count_ = count_ - pred_(old_value) + pred_(new_value);
+        }
+
+        void on_erase(std::size_t, const T& old_value) override
+        {
+            count_ -= pred_(old_value);
+        }
+
+        void on_rebuild(const std::vector<T>& values, std::size_t) override
+        {
+            count_ = 0;
+            for(const auto& v : values)
+                count_ += pred_(v);
+        }
+
+    private:
+        Predicate pred_;
+        std::size_t count_ = 0;
+    };
+
+
+    namespace detail
+    {
+        // Value that never wins the comparison, held by free slots
+        template<typename T, typename Compare>
+        constexpr T extremum_identity()
+        {
+            static_assert(std::numeric_limits<T>::is_specialized, "Extremum observers need numeric_limits");
+            constexpr bool less = std::is_same_v<Compare, std::less<T>>;
+            if constexpr(std::numeric_limits<T>::has_infinity)
+                return less ? std::numeric_limits<T>::infinity() : -std::numeric_limits<T>::infinity();
+            else
+                return less ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+        }
+    }
+
+    // Minimum or maximum kept in a segment tree over the slots : updates are O(log N) and the
+    // result is the root of the tree
+    template<typename T, typename Compare>
+    class extremum_observer : public column_observer<T>
+    {
+    public:
+        // Empty if the column is empty
+        std::optional<T> value() const
+        {
+            if(count_ == 0)
+                return std::nullopt;
+            return tree_[1];
+        }
+
+        void on_insert(std::size_t slot, const T& value) override
+        {
+            ++count_;
+            update(slot, value);
+        }
+
+        void on_update(std::size_t slot, const T&, const T& new_value) override
+        {
+            update(slot, new_value);
+        }
+
+        void on_erase(std::size_t slot, const T&) override
+        {
+            --count_;
+            update(slot, identity);
+        }
+
+        void on_rebuild(const std::vector<T>& values, std::size_t capacity) override
+        {
+            leaves_ = capacity;
+            count_ = values.size();
+            tree_.assign(2 * leaves_, identity);
+            std::copy(values.begin(), values.end(), tree_.begin() + static_cast<std::ptrdiff_t>(leaves_));
+            for(std::size_t i = leaves_ - 1; i > 0; --i)
+                tree_[i] = best(tree_[2 * i], tree_[2 * i + 1]);
+        }
+
+    private:
+        static constexpr T identity = detail::extremum_identity<T, Compare>();
+
+        static const T& best(const T& lhs, const T& rhs)
+        {
+            return Compare{}(rhs, lhs) ? rhs : lhs;
+        }
+
+        void update(std::size_t slot, const T& value)
+        {
+            std::size_t i = leaves_ + slot;
+            tree_[i] = value;
+            for(i /= 2; i > 0; i /= 2)
+                tree_[i] = best(tree_[2 * i], tree_[2 * i + 1]);
+        }
+
+        std::vector<T> tree_;
+        std::size_t leaves_ = 0;
+        std::size_t count_ = 0;
+    };
+
+    template<typename T>
+    using min_observer = extremum_observer<T, std::less<T>>;
+
+    template<typename T>
+    using max_observer = extremum_observer<T, std::greater<T>>;
+
+
+    template<typename T>
+    class observed_column
+    {
+    public:
+        explicit observed_column(std::vector<T>& column)
+            : column_(&column)
+        {
+            rebuild();
+        }
+
+        // Create an observer, it is kept up to date from now on
+        template<typename Observer, typename... Args>
+        Observer& attach(Args&&... args)
+        {
+            auto observer = std::make_unique<Observer>(std::forward<Args>(args)...);
+            observer->on_rebuild(*column_, capacity_);
+            Observer& result = *observer;
+            observers_.push_back(std::move(observer));
+            return result;
+        }
+
+        std::size_t size() const
+        {
+            return column_->size();
+        }
+
+        const T& operator[](std::size_t row) const
+        {
+            return (*column_)[row];
+        }
+
+        const std::vector<T>& column() const
+        {
+            return *column_;
+        }
+
+        void push_back(const T& value)
+        {
+            if(next_slot_ == capacity_)
+                rebuild(column_->size() + 1);
+            const std::size_t slot = next_slot_++;
+            column_->push_back(value);
+            alive_add(slot, 1);
+            for(auto& o : observers_)
+                o->on_insert(slot, value);
+        }
+
+        void set(std::size_t row, const T& value)
+        {
+            const std::size_t slot = slot_of(row);
+            const T old = std::exchange((*column_)[row], value);
+            for(auto& o : observers_)
+                o->on_update(slot, old, value);
+        }
+
+        // Keeps the order of the rows, the vector moves the following elements
+        void erase(std::size_t row)
+        {
+            const std::size_t slot = slot_of(row);
+            const T old = std::move((*column_)[row]);
+            column_->erase(column_->begin() + static_cast<std::ptrdiff_t>(row));
+            alive_add(slot, -1);
+            ++free_slots_;
+            for(auto& o : observers_)
+                o->on_erase(slot, old);
+
+            // Renumber when most slots are free so that the trees don't grow with the erasures
+            if(free_slots_ > column_->size() and free_slots_ > 64)
+                rebuild();
+        }
+
+        // O(log N) : the last row takes the place of the erased one
+        void erase_unordered(std::size_t row)
+        {
+            const std::size_t last = column_->size() - 1;
+            if(row != last)
+                set(row, (*column_)[last]);
+            erase(last);
+        }
+
+        void pop_back()
+        {
+            erase(column_->size() - 1);
+        }
+
+        // To call after the vector was modified without going through observed_column
+        void resync()
+        {
+            rebuild();
+        }
+
+    private:
+        // Renumber the slots so that row i is in slot i, with room for at least rows slots
+        void rebuild(std::size_t rows = 0)
+        {
+            capacity_ = 16;
+            while(capacity_ < 2 * std::max(rows, column_->size()))
+                capacity_ *= 2;
+            next_slot_ = column_->size();
+            free_slots_ = 0;
+
+            // Fenwick tree of the alive slots, built in O(capacity)
+            alive_.assign(capacity_ + 1, 0);
+            for(std::size_t i = 1; i <= next_slot_; ++i)
+                alive_[i] += 1;
+            for(std::size_t i = 1; i <= capacity_; ++i)
+            {
+                const std::size_t parent = i + (i & (~i + 1));
+                if(parent <= capacity_)
+                    alive_[parent] += alive_[i];
+            }
+
+            for(auto& o : observers_)
+                o->on_rebuild(*column_, capacity_);
+        }
+
+        void alive_add(std::size_t slot, int delta)
+        {
+            for(std::size_t i = slot + 1; i <= capacity_; i += i & (~i + 1))
+                alive_[i] += delta;
+        }
+
+        // Slot of the row-th alive slot, found by descending the Fenwick tree
+        std::size_t slot_of(std::size_t row) const
+        {
+            std::size_t position = 0;
+            std::ptrdiff_t remaining = static_cast<std::ptrdiff_t>(row) + 1;
+            for(std::size_t step = capacity_; step > 0; step /= 2)
+                if(position + step <= capacity_ and alive_[position + step] < remaining)
+                {
+                    position += step;
+                    remaining -= alive_[position];
+                }
+            return position;
+        }
+
+        std::vector<T>* column_;
+        std::vector<std::unique_ptr<column_observer<T>>> observers_;
+        std::vector<std::ptrdiff_t> alive_;
+        std::size_t capacity_ = 0;
+        std::size_t next_slot_ = 0;
+        std::size_t free_slots_ = 0;
+    };
+}
+#endif //COLUMN_AGGREGATES_CPP17_HPP
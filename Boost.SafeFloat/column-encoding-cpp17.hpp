@@ -0,0 +1,643 @@
+#ifndef COLUMN_ENCODING_CPP17_HPP
+#define COLUMN_ENCODING_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include "filter-cpp17.hpp"
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+
+namespace test
+{
+    /*
+     * Compressed representations of a column :
+     *   - rle_column<T> : run-length encoding, for columns with long runs of equal values
+     *     (like the ones created by vectorize)
+     *   - dictionary_column<T> : each distinct value is stored once and rows hold a 32 bits
+     *     code, for low cardinality columns (strings, const char*...)
+     *   - frame_of_reference_column<T> : integers stored by blocks as offsets to the minimum of
+     *     the block, using the smallest width that fits, for monotonic or clustered integers
+     * They all provide size(), operator[], push_back(), decode() to get back a std::vector<T>,
+     * select(op, value) evaluating op(row_value, value) into a selection (see filter-cpp17.hpp)
+     * directly on the encoded data, reductions and compact() to re-encode after mutations.
+     */
+
+
+    template<typename T>
+    class rle_column
+    {
+    public:
+        rle_column() = default;
+
+        // N times the same value, a single run
+        rle_column(std::size_t N, const T& value)
+        {
+            if(N != 0)
+            {
+                values_.push_back(value);
+                ends_.push_back(N);
+            }
+        }
+
+        explicit rle_column(const std::vector<T>& data)
+        {
+            for(const auto& v : data)
+                push_back(v);
+        }
+
+        std::size_t size() const
+        {
+            return ends_.empty() ? 0 : ends_.back();
+        }
+
+        // Number of runs
+        std::size_t runs() const
+        {
+            return values_.size();
+        }
+
+        // Random access is a binary search on the runs
+        const T& operator[](std::size_t row) const
+        {
+            return values_[run_of(row)];
+        }
+
+        void push_back(const T& value)
+        {
+            if(!values_.empty() and values_.back() == value)
+                ++ends_.back();
+            else
+            {
+                values_.push_back(value);
+                ends_.push_back(size() + 1);
+            }
+        }
+
+        // Change the value of one row, splits its run if needed
+        // Neighbouring runs aren't merged, call compact() after a batch of set()
+        void set(std::size_t row, const T& value)
+        {
+            const std::size_t run = run_of(row);
+            if(values_[run] == value)
+                return;
+
+            const std::size_t begin = run == 0 ? 0 : ends_[run - 1];
+            const std::size_t end = ends_[run];
+            const T old = values_[run];
+
+            // Replace [begin, end) by [begin, row) [row, row+1) [row+1, end), dropping empty runs
+            std::vector<T> values;
+            std::vector<std::size_t> ends;
+            if(begin < row)
+            {
+                values.push_back(old);
+                ends.push_back(row);
+            }
+            values.push_back(value);
+            ends.push_back(row + 1);
+            if(row + 1 < end)
+            {
+                values.push_back(old);
+                ends.push_back(end);
+            }
+
+            values_.erase(values_.begin() + run);
+            ends_.erase(ends_.begin() + run);
+            values_.insert(values_.begin() + run, values.begin(), values.end());
+            ends_.insert(ends_.begin() + run, ends.begin(), ends.end());
+        }
+
+        // Merge adjacent runs holding equal values
+        void compact()
+        {
+            std::size_t out = 0;
+            for(std::size_t run = 0; run < values_.size(); ++run)
+            {
+                if(out != 0 and values_[out - 1] == values_[run])
+                    ends_[out - 1] = ends_[run];
+                else
+                {
+                    values_[out] = values_[run];
+                    ends_[out] = ends_[run];
+                    ++out;
+                }
+            }
+            values_.resize(out);
+            ends_.resize(out);
+        }
+
+        std::vector<T> decode() const
+        {
+            std::vector<T> result;
+            result.reserve(size());
+            for(std::size_t run = 0; run < values_.size(); ++run)
+                result.insert(result.end(), ends_[run] - result.size(), values_[run]);
+            return result;
+        }
+
+        // One comparison per run
+        template<typename Op, typename V>
+        selection select(Op op, const V& value) const
+        {
+            selection result(size());
+            std::size_t begin = 0;
+            for(std::size_t run = 0; run < values_.size(); ++run)
+            {
+                if(op(values_[run], value))
+                    result.set_range(begin, ends_[run]);
+                begin = ends_[run];
+            }
+            return result;
+        }
+
+        // Sum of every row, one multiplication per run
+        template<typename R = T>
+        R sum() const
+        {
+            R result{};
+            std::size_t begin = 0;
+            for(std::size_t run = 0; run < values_.size(); ++run)
+            {
+                result += static_cast<R>(values_[run]) * static_cast<R>(ends_[run] - begin);
+                begin = ends_[run];
+            }
+            return result;
+        }
+
+        // The column must not be empty
+        const T& min() const
+        {
+            return *std::min_element(values_.begin(), values_.end());
+        }
+
+        const T& max() const
+        {
+            return *std::max_element(values_.begin(), values_.end());
+        }
+
+        std::size_t encoded_bytes() const
+        {
+            return values_.size() * sizeof(T) + ends_.size() * sizeof(std::size_t);
+        }
+
+    private:
+        std::size_t run_of(std::size_t row) const
+        {
+            return static_cast<std::size_t>(std::upper_bound(ends_.begin(), ends_.end(), row) - ends_.begin());
+        }
+
+        std::vector<T> values_;
+        // Cumulative end of each run (exclusive)
+        std::vector<std::size_t> ends_;
+    };
+
+    // Same as vectorize but every column is run-length encoded, so it's a single run each
+    template<typename Tuple>
+    auto vectorize_rle(std::size_t N, Tuple&& t)
+    {
+        return std::apply([N](auto&&... values)
+                          {
+                              return std::make_tuple(rle_column<std::decay_t<decltype(values)>>(N, values)...);
+                          }, std::forward<Tuple>(t));
+    }
+
+
+    namespace detail
+    {
+        // C strings are deduplicated by content and not by address
+        template<typename T>
+        struct dictionary_traits
+        {
+            using hash = std::hash<T>;
+            using equal = std::equal_to<T>;
+        };
+
+        template<>
+        struct dictionary_traits<const char*>
+        {
+            struct hash
+            {
+                std::size_t operator()(const char* s) const
+                {
+                    return std::hash<std::string_view>{}(s);
+                }
+            };
+
+            struct equal
+            {
+                bool operator()(const char* lhs, const char* rhs) const
+                {
+                    return std::string_view(lhs) == rhs;
+                }
+            };
+        };
+    }
+
+    template<typename T,
+             typename Hash = typename detail::dictionary_traits<T>::hash,
+             typename KeyEqual = typename detail::dictionary_traits<T>::equal>
+    class dictionary_column
+    {
+    public:
+        using code_type = std::uint32_t;
+
+        dictionary_column() = default;
+
+        dictionary_column(std::size_t N, const T& value)
+            : codes_(N, N != 0 ? code_of(value) : 0)
+        {}
+
+        explicit dictionary_column(const std::vector<T>& data)
+        {
+            codes_.reserve(data.size());
+            for(const auto& v : data)
+                push_back(v);
+        }
+
+        std::size_t size() const
+        {
+            return codes_.size();
+        }
+
+        const T& operator[](std::size_t row) const
+        {
+            return dictionary_[codes_[row]];
+        }
+
+        void push_back(const T& value)
+        {
+            codes_.push_back(code_of(value));
+        }
+
+        // The old value stays in the dictionary until compact()
+        void set(std::size_t row, const T& value)
+        {
+            codes_[row] = code_of(value);
+        }
+
+        // Distinct values, indexed by code
+        const std::vector<T>& dictionary() const
+        {
+            return dictionary_;
+        }
+
+        const std::vector<code_type>& codes() const
+        {
+            return codes_;
+        }
+
+        // Remove the values no row refers to anymore and renumber the codes
+        void compact()
+        {
+            constexpr code_type unused = std::numeric_limits<code_type>::max();
+            std::vector<code_type> remap(dictionary_.size(), unused);
+            std::vector<T> dictionary;
+            for(auto& c : codes_)
+            {
+                if(remap[c] == unused)
+                {
+                    remap[c] = static_cast<code_type>(dictionary.size());
+                    dictionary.push_back(dictionary_[c]);
+                }
+                c = remap[c];
+            }
+
+            dictionary_ = std::move(dictionary);
+            index_.clear();
+            for(code_type c = 0; c < dictionary_.size(); ++c)
+                index_.emplace(dictionary_[c], c);
+        }
+
+        std::vector<T> decode() const
+        {
+            std::vector<T> result;
+            result.reserve(size());
+            for(auto c : codes_)
+                result.push_back(dictionary_[c]);
+            return result;
+        }
+
+        // The predicate is evaluated once per distinct value then rows are tested with a lookup
+        // of their code, equality is a plain comparison of codes
+        template<typename Op, typename V>
+        selection select(Op op, const V& value) const
+        {
+            selection result(size());
+            if constexpr(std::is_same_v<Op, std::equal_to<>>)
+            {
+                auto it = index_.find(value);
+                if(it != index_.end())
+                    detail::compare_words(codes_.data(), codes_.size(), it->second,
+                                          std::equal_to<>{}, result.words().data());
+            }
+            else
+            {
+                std::vector<unsigned char> matches(dictionary_.size());
+                for(std::size_t c = 0; c < dictionary_.size(); ++c)
+                    matches[c] = op(dictionary_[c], value);
+                const unsigned char* m = matches.data();
+                detail::compare_words(codes_.data(), codes_.size(), 0,
+                                      [m](code_type c, int){ return m[c] != 0; },
+                                      result.words().data());
+            }
+            return result;
+        }
+
+        // Number of rows equal to value, without touching the dictionary
+        std::size_t count(const T& value) const
+        {
+            auto it = index_.find(value);
+            return it == index_.end() ? 0 : static_cast<std::size_t>(std::count(codes_.begin(), codes_.end(), it->second));
+        }
+
+        std::size_t encoded_bytes() const
+        {
+            return dictionary_.size() * sizeof(T) + codes_.size() * sizeof(code_type);
+        }
+
+    private:
+        code_type code_of(const T& value)
+        {
+            auto [it, inserted] = index_.emplace(value, static_cast<code_type>(dictionary_.size()));
+            if(inserted)
+                dictionary_.push_back(value);
+            return it->second;
+        }
+
+        std::vector<T> dictionary_;
+        std::vector<code_type> codes_;
+        std::unordered_map<T, code_type, Hash, KeyEqual> index_;
+    };
+
+
+    template<typename T>
+    class frame_of_reference_column
+    {
+        static_assert(std::is_integral_v<T>, "Frame of reference encoding is for integer columns");
+
+    public:
+        // Rows per block, a multiple of the bitmap word size so a block fills whole words
+        static constexpr std::size_t block_size = 256;
+
+        frame_of_reference_column() = default;
+
+        frame_of_reference_column(std::size_t N, const T& value)
+            : frame_of_reference_column(std::vector<T>(N, value))
+        {}
+
+        explicit frame_of_reference_column(const std::vector<T>& data)
+        {
+            for(std::size_t begin = 0; begin < data.size(); begin += block_size)
+                append_block(data.data() + begin, std::min(block_size, data.size() - begin));
+        }
+
+        std::size_t size() const
+        {
+            return blocks_.empty() ? 0 : (blocks_.size() - 1) * block_size + blocks_.back().count;
+        }
+
+        T operator[](std::size_t row) const
+        {
+            const block& b = blocks_[row / block_size];
+            return with_offsets(b, [&](const auto* offsets)
+                                {
+                                    return from_offset(b.base, offsets[row % block_size]);
+                                });
+        }
+
+        // Appending a value that doesn't fit in the width of the last block re-encodes that block
+        void push_back(const T& value)
+        {
+            if(blocks_.empty() or blocks_.back().count == block_size)
+            {
+                append_block(&value, 1);
+                return;
+            }
+
+            block& last = blocks_.back();
+            if(value >= last.base and to_offset(last.base, value) <= max_offset(last.width))
+            {
+                const unsigned_type offset = to_offset(last.base, value);
+                with_offsets_vector(last.width, [&](auto& offsets)
+                                    {
+                                        using offset_type = typename std::decay_t<decltype(offsets)>::value_type;
+                                        offsets.push_back(static_cast<offset_type>(offset));
+                                    });
+                last.max = std::max(last.max, offset);
+                ++last.count;
+            }
+            else
+            {
+                std::vector<T> values = decode_block(blocks_.size() - 1);
+                values.push_back(value);
+                pop_block();
+                append_block(values.data(), values.size());
+            }
+        }
+
+        // Re-encode every block with the smallest width that fits
+        void compact()
+        {
+            *this = frame_of_reference_column(decode());
+        }
+
+        std::vector<T> decode() const
+        {
+            std::vector<T> result;
+            result.reserve(size());
+            for(std::size_t i = 0; i < blocks_.size(); ++i)
+            {
+                auto values = decode_block(i);
+                result.insert(result.end(), values.begin(), values.end());
+            }
+            return result;
+        }
+
+        // The value is translated in the offset domain of each block, blocks entirely below or
+        // above it are filled without looking at their rows. A value that T can't hold exactly
+        // (2.5 for an integer column) is compared with the decoded rows instead
+        template<typename Op, typename V>
+        selection select(Op op, const V& value) const
+        {
+            selection result(size());
+            std::uint64_t* words = result.words().data();
+            for(const block& b : blocks_)
+            {
+                const T high = from_offset(b.base, b.max);
+                if(value < b.base)
+                    result.set_range(b.first, b.first + b.count, op(b.base, value));
+                else if(value > high)
+                    result.set_range(b.first, b.first + b.count, op(high, value));
+                else if(static_cast<V>(static_cast<T>(value)) != value)
+                {
+                    with_offsets(b, [&](const auto* offsets)
+                                 {
+                                     for(std::size_t i = 0; i < b.count; ++i)
+                                         if(op(from_offset(b.base, offsets[i]), value))
+                                             result.set(b.first + i);
+                                     return 0;
+                                 });
+                }
+                else
+                {
+                    const unsigned_type offset = to_offset(b.base, static_cast<T>(value));
+                    with_offsets(b, [&](const auto* offsets)
+                                 {
+                                     using offset_type = std::decay_t<decltype(*offsets)>;
+                                     detail::compare_words(offsets, b.count, static_cast<offset_type>(offset),
+                                                           op, words + b.first / detail::bitmap_word_bits);
+                                     return 0;
+                                 });
+                }
+            }
+            return result;
+        }
+
+        // Sum of every row : count * base plus the sum of the narrow offsets of each block
+        template<typename R = T>
+        R sum() const
+        {
+            R result{};
+            for(const block& b : blocks_)
+            {
+                result += with_offsets(b, [&](const auto* offsets)
+                                       {
+                                           R s{};
+                                           for(std::size_t i = 0; i < b.count; ++i)
+                                               s += static_cast<R>(offsets[i]);
+                                           return s;
+                                       });
+                result += static_cast<R>(b.base) * static_cast<R>(b.count);
+            }
+            return result;
+        }
+
+        // Only looks at the block headers, the column must not be empty
+        T min() const
+        {
+            T result = blocks_.front().base;
+            for(const block& b : blocks_)
+                result = std::min(result, b.base);
+            return result;
+        }
+
+        T max() const
+        {
+            T result = from_offset(blocks_.front().base, blocks_.front().max);
+            for(const block& b : blocks_)
+                result = std::max(result, from_offset(b.base, b.max));
+            return result;
+        }
+
+        std::size_t encoded_bytes() const
+        {
+            return blocks_.size() * sizeof(block) + offsets8_.size() + offsets16_.size() * 2
+                 + offsets32_.size() * 4 + offsets64_.size() * 8;
+        }
+
+    private:
+        using unsigned_type = std::make_unsigned_t<T>;
+
+        struct block
+        {
+            T base;                 // Minimum of the block
+            unsigned_type max;      // Maximum offset of the block
+            unsigned char width;    // Width of the offsets in bytes : 1, 2, 4 or 8
+            std::size_t first;      // First row of the block
+            std::size_t start;      // Index of the first offset in the offsets vector of its width
+            std::size_t count;      // Number of rows
+        };
+
+        // Modular arithmetic on the unsigned type so that the whole range of T is handled
+        static unsigned_type to_offset(T base, T value)
+        {
+            return static_cast<unsigned_type>(static_cast<unsigned_type>(value) - static_cast<unsigned_type>(base));
+        }
+
+        static T from_offset(T base, unsigned_type offset)
+        {
+            return static_cast<T>(static_cast<unsigned_type>(static_cast<unsigned_type>(base) + offset));
+        }
+
+        static unsigned_type max_offset(unsigned char width)
+        {
+            return width >= sizeof(unsigned_type) ? std::numeric_limits<unsigned_type>::max()
+                                                  : static_cast<unsigned_type>((std::uint64_t{1} << (8 * width)) - 1);
+        }
+
+        template<typename F>
+        decltype(auto) with_offsets_vector(unsigned char width, F&& f)
+        {
+            switch(width)
+            {
+                case 1: return f(offsets8_);
+                case 2: return f(offsets16_);
+                case 4: return f(offsets32_);
+                default: return f(offsets64_);
+            }
+        }
+
+        // Call f with a pointer to the first offset of a block, typed according to its width
+        template<typename F>
+        decltype(auto) with_offsets(const block& b, F&& f) const
+        {
+            switch(b.width)
+            {
+                case 1: return f(offsets8_.data() + b.start);
+                case 2: return f(offsets16_.data() + b.start);
+                case 4: return f(offsets32_.data() + b.start);
+                default: return f(offsets64_.data() + b.start);
+            }
+        }
+
+        void append_block(const T* values, std::size_t count)
+        {
+            const auto [low, high] = std::minmax_element(values, values + count);
+            block b{*low, to_offset(*low, *high), 8, size(), 0, count};
+            for(unsigned char width : {1, 2, 4})
+                if(b.max <= max_offset(width))
+                {
+                    b.width = width;
+                    break;
+                }
+
+            with_offsets_vector(b.width, [&](auto& offsets)
+                                {
+                                    using offset_type = typename std::decay_t<decltype(offsets)>::value_type;
+                                    b.start = offsets.size();
+                                    for(std::size_t i = 0; i < count; ++i)
+                                        offsets.push_back(static_cast<offset_type>(to_offset(b.base, values[i])));
+                                });
+            blocks_.push_back(b);
+        }
+
+        // The offsets of the last block are at the end of their vector
+        void pop_block()
+        {
+            const block& b = blocks_.back();
+            with_offsets_vector(b.width, [&](auto& offsets){ offsets.resize(b.start); });
+            blocks_.pop_back();
+        }
+
+        std::vector<T> decode_block(std::size_t i) const
+        {
+            const block& b = blocks_[i];
+            return with_offsets(b, [&](const auto* offsets)
+                                {
+                                    std::vector<T> values(b.count);
+                                    for(std::size_t j = 0; j < b.count; ++j)
+                                        values[j] = from_offset(b.base, offsets[j]);
+                                    return values;
+                                });
+        }
+
+        std::vector<block> blocks_;
+        std::vector<std::uint8_t> offsets8_;
+        std::vector<std::uint16_t> offsets16_;
+        std::vector<std::uint32_t> offsets32_;
+        std::vector<std::uint64_t> offsets64_;
+    };
+}
+#endif //COLUMN_ENCODING_CPP17_HPP
@@ -0,0 +1,225 @@
+#ifndef COLUMN_INDEX_CPP17_HPP
+#define COLUMN_INDEX_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include "parallel-cpp17.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+
+
+namespace test
+{
+    /*
+     * Hash index over one column of a tuple of vectors (as created by vectorize), mapping the
+     * values of the column to their row ids, so that point lookups don't need a linear scan.
+     * The table uses open addressing with linear probing over the distinct values, each slot
+     * being the head of the chain of the rows holding that value, so duplicated values (as many
+     * as vectorize creates) cost O(1) each.
+     * The index keeps a pointer to the indexed vector : it must outlive the index and rows added
+     * to it are only visible after a call to update().
+     */
+    template<typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+    class column_index
+    {
+    public:
+        // Bulk build of the index over every row of the column, using up to `threads` threads
+        // (0 means as many as the hardware offers)
+        explicit column_index(const std::vector<T>& column, unsigned threads = 0,
+                              Hash hash = Hash{}, KeyEqual equal = KeyEqual{})
+            : column_(&column), hash_(std::move(hash)), equal_(std::move(equal))
+        {
+            update(threads);
+        }
+
+        // Index the rows appended to the column since the last update
+        // If the column shrank, the index is rebuilt from scratch
+        void update(unsigned threads = 1)
+        {
+            const std::size_t rows = column_->size();
+            if(rows < indexed_)
+            {
+                capacity_ = 0;
+                indexed_ = 0;
+            }
+            next_.resize(rows);
+            // Keep the load factor under 0.5 so that probe sequences stay short
+            if(2 * rows > capacity_)
+                rehash(2 * rows);
+
+            const std::size_t first = indexed_;
+            detail::parallel_for_chunks(rows - first, threads,
+                [this, first](unsigned, std::size_t begin, std::size_t end)
+                {
+                    for(std::size_t row = first + begin; row < first + end; ++row)
+                        insert(row, hash_((*column_)[row]));
+                });
+            indexed_ = rows;
+        }
+
+        // Number of rows in the index
+        std::size_t size() const
+        {
+            return indexed_;
+        }
+
+        // Row id of a row whose value is key, if any
+        std::optional<std::size_t> find(const T& key) const
+        {
+            std::optional<std::size_t> result;
+            probe(key, [&result](std::size_t row){ result = row; return false; });
+            return result;
+        }
+
+        // Row ids of every row whose value is key, in no particular order
+        std::vector<std::size_t> find_all(const T& key) const
+        {
+            std::vector<std::size_t> result;
+            probe(key, [&result](std::size_t row){ result.push_back(row); return true; });
+            return result;
+        }
+
+        // Same as find but returns a view of the whole row of tv (see get_row)
+        template<typename Tuple>
+        auto lookup(Tuple& tv, const T& key) const
+        {
+            std::optional<decltype(get_row(tv, 0))> result;
+            if(auto row = find(key))
+                result.emplace(get_row(tv, *row));
+            return result;
+        }
+
+        // Same as find_all but returns views of the whole rows of tv
+        template<typename Tuple>
+        auto lookup_all(Tuple& tv, const T& key) const
+        {
+            std::vector<decltype(get_row(tv, 0))> result;
+            probe(key, [&](std::size_t row){ result.push_back(get_row(tv, row)); return true; });
+            return result;
+        }
+
+    private:
+        // Slots and chain links hold row+1 so that 0 means empty
+        static constexpr std::size_t empty = 0;
+        static constexpr std::size_t min_capacity = 16;
+
+        // Fibonacci hashing : spreads poor hashes (like identity hash of integers) over the table
+        std::size_t home(std::size_t h) const
+        {
+            return static_cast<std::size_t>((static_cast<std::uint64_t>(h) * 0x9E3779B97F4A7C15ull) >> shift_);
+        }
+
+        // Allocate a table of at least `wanted` slots and move the already indexed chains in it,
+        // reusing their stored hashes
+        void rehash(std::size_t wanted)
+        {
+            std::size_t capacity = min_capacity;
+            unsigned bits = 4;
+            while(capacity < wanted)
+            {
+                capacity *= 2;
+                ++bits;
+            }
+
+            auto old_rows = std::move(rows_);
+            auto old_hashes = std::move(hashes_);
+            const std::size_t old_capacity = old_rows ? capacity_ : 0;
+
+            rows_ = std::make_unique<std::atomic<std::size_t>[]>(capacity);
+            hashes_ = std::make_unique<std::size_t[]>(capacity);
+            capacity_ = capacity;
+            shift_ = 64 - bits;
+
+            for(std::size_t i = 0; i < old_capacity; ++i)
+            {
+                const std::size_t r = old_rows[i].load(std::memory_order_relaxed);
+                if(r != empty)
+                    place(r, old_hashes[i]);
+            }
+        }
+
+        // Store the head of a chain in the first empty slot, keys are distinct during a rehash
+        void place(std::size_t head, std::size_t h)
+        {
+            const std::size_t mask = capacity_ - 1;
+            std::size_t i = home(h);
+            while(rows_[i].load(std::memory_order_relaxed) != empty)
+                i = (i + 1) & mask;
+            rows_[i].store(head, std::memory_order_relaxed);
+            hashes_[i] = h;
+        }
+
+        // Push row on the chain of its value, claiming an empty slot if the value is new.
+        // May be called concurrently : only the slots are shared, next_[row] is only written by
+        // the thread inserting row
+        void insert(std::size_t row, std::size_t h)
+        {
+            const std::size_t mask = capacity_ - 1;
+            for(std::size_t i = home(h);; i = (i + 1) & mask)
+            {
+                std::size_t head = rows_[i].load(std::memory_order_relaxed);
+                if(head == empty)
+                {
+                    next_[row] = empty;
+                    if(rows_[i].compare_exchange_strong(head, row + 1, std::memory_order_relaxed))
+                    {
+                        hashes_[i] = h;
+                        return;
+                    }
+                    // Claimed concurrently, head is now the row stored by the other thread
+                }
+                if(equal_((*column_)[head - 1], (*column_)[row]))
+                {
+                    do
+                        next_[row] = head;
+                    while(!rows_[i].compare_exchange_weak(head, row + 1, std::memory_order_relaxed));
+                    return;
+                }
+            }
+        }
+
+        // Call f(row) for every row whose value is key until f returns false
+        template<typename F>
+        void probe(const T& key, F&& f) const
+        {
+            if(indexed_ == 0)
+                return;
+            const std::size_t h = hash_(key);
+            const std::size_t mask = capacity_ - 1;
+            for(std::size_t i = home(h);; i = (i + 1) & mask)
+            {
+                const std::size_t r = rows_[i].load(std::memory_order_relaxed);
+                if(r == empty)
+                    return;
+                if(hashes_[i] == h and equal_((*column_)[r - 1], key))
+                {
+                    for(std::size_t row = r; row != empty; row = next_[row - 1])
+                        if(!f(row - 1))
+                            return;
+                    return;
+                }
+            }
+        }
+
+        const std::vector<T>* column_;
+        Hash hash_;
+        KeyEqual equal_;
+        std::unique_ptr<std::atomic<std::size_t>[]> rows_;
+        std::unique_ptr<std::size_t[]> hashes_;
+        // Next row (+1) with the same value
+        std::vector<std::size_t> next_;
+        std::size_t capacity_ = 0;
+        unsigned shift_ = 0;
+        std::size_t indexed_ = 0;
+    };
+
+    // Build an index over the column of type T of a tuple of vectors
+    template<typename T, typename Tuple>
+    column_index<T> make_column_index(const Tuple& tv, unsigned threads = 0)
+    {
+        return column_index<T>(get_vector<T>(tv), threads);
+    }
+}
+#endif //COLUMN_INDEX_CPP17_HPP
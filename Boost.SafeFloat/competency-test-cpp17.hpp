@@ -1,8 +1,14 @@
 #ifndef COMPETENCY_TEST_CPP17_HPP
 #define COMPETENCY_TEST_CPP17_HPP
 
+#include <limits>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#if defined(__cpp_nontype_template_args) and __cpp_nontype_template_args >= 201911L
+#include <string_view>
+#endif
 
 
 namespace test
@@ -12,6 +18,37 @@ namespace test
      * https://github.com/boostorg/boost/wiki/Boost-Google-Summer-of-Code-2018
      */
     
+    /*
+     * Not part of the test : named columns, for schemas where several columns have the same type
+     * (and get_vector can't be used). A column is named by a tag type :
+     *   struct price; struct tax;
+     *   auto tv = test::vectorize(N, std::make_tuple(test::named<price>(1.5), test::named<tax>(0.2)));
+     *   test::get_column<price>(tv);    // test::named_vector<price, double>&, a std::vector<double>
+     * In C++20 the name can also be a string : test::get_column<"price"_col>(tv)
+     */
+    template<typename Name, typename T>
+    struct named_value
+    {
+        using name_type = Name;
+        T value;
+    };
+
+    template<typename Name, typename T>
+    constexpr named_value<Name, std::decay_t<T>> named(T&& value)
+    {
+        return {std::forward<T>(value)};
+    }
+
+    // A vector with a name, usable wherever a std::vector<T> is expected
+    template<typename Name, typename T>
+    class named_vector : public std::vector<T>
+    {
+    public:
+        using name_type = Name;
+        using std::vector<T>::vector;
+    };
+
+
     /*
      * Provide a function receiving an integer (X) and a tuple (std::tuple<type1, type2, type3…>) 
      * into a tuple of vectors (std::tuple<std::vector,std::vector, std::vector, …>)
@@ -32,6 +69,12 @@ namespace test
             return std::vector<T>(N, t);
         }
 
+        template<typename Name, typename T>
+        auto make_vector(std::size_t N, named_value<Name, T> t)
+        {
+            return named_vector<Name, T>(N, t.value);
+        }
+
         // Call make_vector for the Ith element for every I and pack the vectors in a tuple
         template<typename Tuple, std::size_t... I>
         auto vectorize_impl(std::size_t N, Tuple&& t, std::index_sequence<I...>)
@@ -67,8 +110,122 @@ namespace test
     {
         return std::get<std::vector<T>>(t);
     }
-    
-    
+
+
+    /*
+     * Not part of the test : access to a named column, found at compile time. The position is
+     * computed by a single constexpr function over the pack of names, so a lookup costs the same
+     * number of instantiations however wide the tuple is
+     */
+    namespace detail
+    {
+        template<typename T, typename = void>
+        struct column_name
+        {
+            using type = void;
+        };
+
+        template<typename T>
+        struct column_name<T, std::void_t<typename T::name_type>>
+        {
+            using type = typename T::name_type;
+        };
+
+        template<typename Name, typename Tuple>
+        struct column_position;
+
+        template<typename Name, typename... Columns>
+        struct column_position<Name, std::tuple<Columns...>>
+        {
+            static constexpr std::size_t find()
+            {
+                constexpr bool matches[] = {false, std::is_same_v<Name, typename column_name<Columns>::type>...};
+                std::size_t count = 0;
+                std::size_t position = 0;
+                for(std::size_t i = 1; i < sizeof...(Columns) + 1; ++i)
+                    if(matches[i])
+                    {
+                        ++count;
+                        position = i - 1;
+                    }
+                return count == 1 ? position : sizeof...(Columns);
+            }
+
+            static constexpr std::size_t value = find();
+            static_assert(value != sizeof...(Columns), "No column or several columns with this name");
+        };
+    }
+
+    template<typename Name, typename Tuple>
+    auto& get_column(Tuple& t)
+    {
+        return std::get<detail::column_position<Name, std::remove_const_t<Tuple>>::value>(t);
+    }
+
+#if defined(__cpp_nontype_template_args) and __cpp_nontype_template_args >= 201911L
+    // C++20 : names written as strings, "price"_col is a name just like a tag type
+    template<std::size_t N>
+    struct fixed_string
+    {
+        char data[N];
+
+        constexpr fixed_string(const char (&str)[N])
+        {
+            for(std::size_t i = 0; i < N; ++i)
+                data[i] = str[i];
+        }
+    };
+
+    template<fixed_string NAME>
+    struct column_key
+    {
+        static constexpr std::string_view name{NAME.data, sizeof(NAME.data) - 1};
+    };
+
+    namespace literal
+    {
+        template<fixed_string NAME>
+        constexpr column_key<NAME> operator""_col()
+        {
+            return {};
+        }
+    }
+
+    template<auto KEY, typename T>
+    constexpr auto named(T&& value)
+    {
+        return named<std::remove_const_t<decltype(KEY)>>(std::forward<T>(value));
+    }
+
+    template<auto KEY, typename Tuple>
+    auto& get_column(Tuple& t)
+    {
+        return get_column<std::remove_const_t<decltype(KEY)>>(t);
+    }
+#endif
+
+
+    /*
+     * Not part of the test : access to the row-th element of every vector of a tuple of vectors
+     * at once, as a tuple of references (const references for a const tuple)
+     */
+    namespace detail
+    {
+        template<typename Tuple, std::size_t... I>
+        auto get_row_impl(Tuple& t, std::size_t row, std::index_sequence<I...>)
+        {
+            return std::tie(std::get<I>(t)[row]...);
+        }
+    }
+
+    template<typename Tuple>
+    auto get_row(Tuple& t, std::size_t row)
+    {
+        return detail::get_row_impl(t, row,
+                                    std::make_index_sequence<std::tuple_size_v<std::remove_const_t<Tuple>>>{});
+    }
+
+
     /*
      * Define a user defined literal assignable to float that fails compilation
      * when the value provided cannot be expressed as an positive integer power
@@ -156,6 +313,50 @@ namespace test
                 : x * trivial_pow(x, e-1);
         }
         
+        /*
+         * Every positive power of 0.5 representable in RT (subnormals included), computed once
+         * per type : values[k] is 0.5^k. Validating a value is then a lookup of its exponent
+         * instead of a recursion as deep as the exponent
+         */
+        template<typename RT>
+        struct pow_of_0_5_table
+        {
+            // 0.5^size is the smallest positive subnormal
+            static constexpr int size = std::numeric_limits<RT>::digits - std::numeric_limits<RT>::min_exponent;
+            RT values[size + 1];
+
+            constexpr pow_of_0_5_table()
+                : values{}
+            {
+                RT value = 1;
+                for(int k = 0; k <= size; ++k)
+                {
+                    values[k] = value;
+                    value /= 2;
+                }
+            }
+
+            // k such that value is 0.5^k (k > 0), 0 if value isn't a positive power of 0.5
+            constexpr int exponent_of(RT value) const
+            {
+                // Binary search, values are decreasing
+                int low = 1;
+                int high = size;
+                while(low < high)
+                {
+                    const int middle = low + (high - low) / 2;
+                    if(values[middle] > value)
+                        low = middle + 1;
+                    else
+                        high = middle;
+                }
+                return values[low] == value ? low : 0;
+            }
+        };
+
+        template<typename RT>
+        inline constexpr pow_of_0_5_table<RT> pow_of_0_5s{};
+
         // A function to know is a literal begins with an hex prefix
         template<char FIRST>
         constexpr bool has_hex_prefix()
@@ -177,12 +378,17 @@ namespace test
         template<typename RT, unsigned long long MANTISSA, int POW, bool SIGN, int EXPONENT>
         constexpr RT validate_hex()
         {
+            constexpr int exponent = count_shift(MANTISSA) + POW + (SIGN? EXPONENT : -EXPONENT);
             // Is it a power of two ?
             static_assert(count_bit(MANTISSA) == 1, VALUE_ERROR);
             // Is the exponent negative (positive power of 0.5 means negative power of 2)
-            static_assert(count_shift(MANTISSA) + POW + (SIGN? EXPONENT : -EXPONENT) < 0,
-                          VALUE_ERROR);
-            return static_cast<RT>(MANTISSA) * trivial_pow(2.0l, POW + (SIGN? EXPONENT : -EXPONENT));
+            static_assert(exponent < 0, VALUE_ERROR);
+            // Is it representable (not rounded to 0) ?
+            static_assert(-exponent <= pow_of_0_5_table<RT>::size, VALUE_ERROR);
+            if constexpr(count_bit(MANTISSA) == 1 and exponent < 0 and -exponent <= pow_of_0_5_table<RT>::size)
+                return pow_of_0_5s<RT>.values[-exponent];
+            else
+                return RT{};
         }
         
         
@@ -285,20 +491,11 @@ namespace test
          * Dec parsing related functions (better understanding by reading from bottom to top)
          */
         
-        // Test if value is power of 0.5 by recursively multiplying it by 2 and compare with 1
-        template<typename RT>
-        constexpr bool is_pow_of_0_5_impl(RT value)
-        {
-            return value == 1 ? true
-                 : value > 1 ? false
-                 : value == 0 ? false
-                 : is_pow_of_0_5_impl(2*value);
-        }
-        
+        // Test if value is power of 0.5 by looking for it in the table of the powers of 0.5
         template<typename RT>
         constexpr bool is_pow_of_0_5(RT value)
         {
-            return is_pow_of_0_5_impl(2*value);
+            return pow_of_0_5s<RT>.exponent_of(value) != 0;
         }
         
         // Validate value and returns it
@@ -0,0 +1,323 @@
+#ifndef DYNAMIC_TABLE_CPP17_HPP
+#define DYNAMIC_TABLE_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+
+
+namespace test
+{
+    /*
+     * Runtime-schema counterpart of the tuples of vectors : the columns of a dynamic_table are
+     * chosen at runtime (from a configuration file for instance) among a fixed list of types.
+     * Each column is a std::variant of vectors, the variant index being the type id.
+     * Kernels are written as generic lambdas, dispatch() does one type switch per column and
+     * calls the kernel instantiated for that type at compile time, so the per-row loop is the
+     * same code as with a std::vector<T> known at compile time.
+     */
+    using column_variant = std::variant<std::vector<std::int32_t>,
+                                        std::vector<std::int64_t>,
+                                        std::vector<float>,
+                                        std::vector<double>,
+                                        std::vector<std::string>>;
+
+    // Type id of a column, the index of its type in column_variant
+    enum class column_type : std::size_t
+    {
+        int32,
+        int64,
+        float32,
+        float64,
+        string
+    };
+
+    namespace detail
+    {
+        constexpr std::string_view column_type_names[] = {"int32", "int64", "float", "double", "string"};
+
+        static_assert(std::size(column_type_names) == std::variant_size_v<column_variant>,
+                      "Every column type needs a name");
+
+        template<std::size_t I>
+        column_variant make_column_variant(std::size_t index, std::size_t N)
+        {
+            if constexpr(I == std::variant_size_v<column_variant>)
+                throw std::out_of_range("Unknown column type id");
+            else if(index == I)
+                return column_variant(std::in_place_index<I>, N);
+            else
+                return make_column_variant<I + 1>(index, N);
+        }
+
+        template<typename T, std::size_t I = 0>
+        constexpr std::size_t column_type_index()
+        {
+            if constexpr(I == std::variant_size_v<column_variant>)
+            {
+                static_assert(always_false<T>::value, "Type not supported by dynamic tables");
+                return I;
+            }
+            else if constexpr(std::is_same_v<std::variant_alternative_t<I, column_variant>, std::vector<T>>)
+                return I;
+            else
+                return column_type_index<T, I + 1>();
+        }
+    }
+
+    // Type id of T
+    template<typename T>
+    constexpr column_type column_type_of()
+    {
+        return static_cast<column_type>(detail::column_type_index<T>());
+    }
+
+    inline std::string_view to_string(column_type type)
+    {
+        return detail::column_type_names[static_cast<std::size_t>(type)];
+    }
+
+    // Parse a type name as found in a schema description ("int32", "double"...)
+    inline column_type parse_column_type(std::string_view name)
+    {
+        for(std::size_t i = 0; i < std::size(detail::column_type_names); ++i)
+            if(detail::column_type_names[i] == name)
+                return static_cast<column_type>(i);
+        throw std::invalid_argument("Unknown column type " + std::string(name));
+    }
+
+    struct column_spec
+    {
+        std::string name;
+        column_type type;
+    };
+
+
+    class dynamic_column
+    {
+    public:
+        dynamic_column(std::string name, column_type type, std::size_t N = 0)
+            : name_(std::move(name)), data_(detail::make_column_variant<0>(static_cast<std::size_t>(type), N))
+        {}
+
+        template<typename T>
+        dynamic_column(std::string name, std::vector<T> data)
+            : name_(std::move(name)), data_(std::move(data))
+        {}
+
+        const std::string& name() const
+        {
+            return name_;
+        }
+
+        column_type type() const
+        {
+            return static_cast<column_type>(data_.index());
+        }
+
+        std::size_t size() const
+        {
+            return std::visit([](const auto& v){ return v.size(); }, data_);
+        }
+
+        // Checked cast to the typed vector
+        template<typename T>
+        std::vector<T>& as()
+        {
+            check<T>();
+            return *std::get_if<std::vector<T>>(&data_);
+        }
+
+        template<typename T>
+        const std::vector<T>& as() const
+        {
+            check<T>();
+            return *std::get_if<std::vector<T>>(&data_);
+        }
+
+        column_variant& data()
+        {
+            return data_;
+        }
+
+        const column_variant& data() const
+        {
+            return data_;
+        }
+
+    private:
+        template<typename T>
+        void check() const
+        {
+            if(type() != column_type_of<T>())
+                throw std::invalid_argument("Column " + name_ + " is of type " + std::string(to_string(type()))
+                                            + ", not " + std::string(to_string(column_type_of<T>())));
+        }
+
+        std::string name_;
+        column_variant data_;
+    };
+
+
+    class dynamic_table
+    {
+    public:
+        dynamic_table() = default;
+
+        explicit dynamic_table(const std::vector<column_spec>& schema, std::size_t N = 0)
+        {
+            for(const auto& spec : schema)
+                add_column(spec.name, spec.type, N);
+        }
+
+        dynamic_column& add_column(std::string name, column_type type, std::size_t N = 0)
+        {
+            check_unique(name);
+            return columns_.emplace_back(std::move(name), type, N);
+        }
+
+        template<typename T>
+        dynamic_column& add_column(std::string name, std::vector<T> data)
+        {
+            check_unique(name);
+            return columns_.emplace_back(std::move(name), std::move(data));
+        }
+
+        std::size_t column_count() const
+        {
+            return columns_.size();
+        }
+
+        std::vector<column_spec> schema() const
+        {
+            std::vector<column_spec> result;
+            for(const auto& c : columns_)
+                result.push_back({c.name(), c.type()});
+            return result;
+        }
+
+        std::size_t index_of(std::string_view name) const
+        {
+            for(std::size_t i = 0; i < columns_.size(); ++i)
+                if(columns_[i].name() == name)
+                    return i;
+            throw std::out_of_range("No column named " + std::string(name));
+        }
+
+        dynamic_column& column(std::size_t i)
+        {
+            return columns_.at(i);
+        }
+
+        const dynamic_column& column(std::size_t i) const
+        {
+            return columns_.at(i);
+        }
+
+        dynamic_column& column(std::string_view name)
+        {
+            return columns_[index_of(name)];
+        }
+
+        const dynamic_column& column(std::string_view name) const
+        {
+            return columns_[index_of(name)];
+        }
+
+        auto begin() { return columns_.begin(); }
+        auto end() { return columns_.end(); }
+        auto begin() const { return columns_.begin(); }
+        auto end() const { return columns_.end(); }
+
+    private:
+        void check_unique(const std::string& name) const
+        {
+            for(const auto& c : columns_)
+                if(c.name() == name)
+                    throw std::invalid_argument("Duplicate column " + name);
+        }
+
+        std::vector<dynamic_column> columns_;
+    };
+
+    // get_vector-like checked access to a column by name or by position
+    template<typename T>
+    std::vector<T>& get_vector(dynamic_table& table, std::string_view name)
+    {
+        return table.column(name).as<T>();
+    }
+
+    template<typename T>
+    const std::vector<T>& get_vector(const dynamic_table& table, std::string_view name)
+    {
+        return table.column(name).as<T>();
+    }
+
+    template<typename T>
+    std::vector<T>& get_vector(dynamic_table& table, std::size_t i)
+    {
+        return table.column(i).as<T>();
+    }
+
+    template<typename T>
+    const std::vector<T>& get_vector(const dynamic_table& table, std::size_t i)
+    {
+        return table.column(i).as<T>();
+    }
+
+    // Build a dynamic table from a tuple of vectors, e.g. the result of vectorize
+    template<typename... Ts>
+    dynamic_table make_dynamic_table(std::tuple<std::vector<Ts>...> tv, const std::vector<std::string>& names)
+    {
+        if(names.size() != sizeof...(Ts))
+            throw std::invalid_argument("One name per column is needed");
+        dynamic_table table;
+        std::size_t i = 0;
+        std::apply([&](auto&... columns){ (table.add_column(names[i++], std::move(columns)), ...); }, tv);
+        return table;
+    }
+
+
+    /*
+     * Dispatch : kernel(std::vector<T>&) is called once for the whole column, with T the actual
+     * type of the column. The kernel is instantiated for every type of column_variant.
+     */
+    template<typename Kernel>
+    decltype(auto) dispatch(dynamic_column& column, Kernel&& kernel)
+    {
+        return std::visit(std::forward<Kernel>(kernel), column.data());
+    }
+
+    template<typename Kernel>
+    decltype(auto) dispatch(const dynamic_column& column, Kernel&& kernel)
+    {
+        return std::visit(std::forward<Kernel>(kernel), column.data());
+    }
+
+    // Same but the kernel is only instantiated for arithmetic columns, others throw
+    template<typename Result, typename Column, typename Kernel>
+    Result dispatch_arithmetic(Column& column, Kernel&& kernel)
+    {
+        return dispatch(column, [&](auto& v) -> Result
+        {
+            using T = typename std::decay_t<decltype(v)>::value_type;
+            if constexpr(std::is_arithmetic_v<T>)
+                return kernel(v);
+            else
+                throw std::invalid_argument("Column " + column.name() + " is not arithmetic");
+        });
+    }
+
+    // Call kernel(column, typed vector) for every column of the table, one dispatch per column
+    template<typename Table, typename Kernel>
+    void for_each_column(Table& table, Kernel&& kernel)
+    {
+        for(auto& column : table)
+            dispatch(column, [&](auto& v){ kernel(column, v); });
+    }
+}
+#endif //DYNAMIC_TABLE_CPP17_HPP
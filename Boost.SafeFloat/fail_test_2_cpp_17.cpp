@@ -0,0 +1,6 @@
+#include "competency-test-cpp17.hpp"
+struct price;
+int main(){
+    auto tv = test::vectorize(2, std::make_tuple(test::named<price>(1.), test::named<price>(2.)));
+    test::get_column<price>(tv); //expected to fail compilation
+}
@@ -0,0 +1,5 @@
+#include "competency-test-cpp17.hpp"
+int main(){
+    using namespace test::literal;
+    0x1p-150_sf; //expected to fail compilation, rounded to 0 in a float
+}
@@ -0,0 +1,538 @@
+#ifndef FILTER_CPP17_HPP
+#define FILTER_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+
+
+namespace test
+{
+    /*
+     * Small query layer over tuples of vectors :
+     *   test::filter(tv, test::column<int>() < 10 && test::column<double>() == 3.14)
+     * Predicates are evaluated column by column into selection bitmaps (one bit per row) by
+     * branch-free kernels the compiler can vectorize, then combined with bitwise operations.
+     * Note that && and || of predicates evaluate both sides, they don't short-circuit.
+     * Every column of the tuple of vectors must have the same size, std::invalid_argument is
+     * thrown otherwise.
+     */
+    namespace detail
+    {
+        constexpr std::size_t bitmap_word_bits = 64;
+
+        constexpr std::size_t bitmap_words(std::size_t bits)
+        {
+            return (bits + bitmap_word_bits - 1) / bitmap_word_bits;
+        }
+
+        // Index of the lowest bit set, word must be non zero
+        inline unsigned countr_zero(std::uint64_t word)
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            return static_cast<unsigned>(__builtin_ctzll(word));
+        #else
+            unsigned count = 0;
+            while(!(word & 0x1))
+            {
+                word >>= 1;
+                ++count;
+            }
+            return count;
+        #endif
+        }
+
+        inline unsigned popcount(std::uint64_t word)
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            return static_cast<unsigned>(__builtin_popcountll(word));
+        #else
+            unsigned count = 0;
+            for(; word != 0; word &= word - 1)
+                ++count;
+            return count;
+        #endif
+        }
+    }
+
+    // Set of selected rows of a table of `size()` rows, stored as a bitmap
+    class selection
+    {
+    public:
+        selection() = default;
+
+        explicit selection(std::size_t size, bool selected = false)
+            : words_(detail::bitmap_words(size), selected ? ~std::uint64_t{0} : 0), size_(size)
+        {
+            clear_padding();
+        }
+
+        std::size_t size() const
+        {
+            return size_;
+        }
+
+        bool operator[](std::size_t row) const
+        {
+            return (words_[row / detail::bitmap_word_bits] >> (row % detail::bitmap_word_bits)) & 0x1;
+        }
+
+        void set(std::size_t row, bool selected = true)
+        {
+            const std::uint64_t bit = std::uint64_t{1} << (row % detail::bitmap_word_bits);
+            if(selected)
+                words_[row / detail::bitmap_word_bits] |= bit;
+            else
+                words_[row / detail::bitmap_word_bits] &= ~bit;
+        }
+
+        // Select or unselect every row in [begin, end)
+        void set_range(std::size_t begin, std::size_t end, bool selected = true)
+        {
+            while(begin < end)
+            {
+                const std::size_t shift = begin % detail::bitmap_word_bits;
+                const std::size_t bits = std::min(end - begin, detail::bitmap_word_bits - shift);
+                const std::uint64_t mask = (bits == detail::bitmap_word_bits ? ~std::uint64_t{0}
+                                                                              : (std::uint64_t{1} << bits) - 1) << shift;
+                if(selected)
+                    words_[begin / detail::bitmap_word_bits] |= mask;
+                else
+                    words_[begin / detail::bitmap_word_bits] &= ~mask;
+                begin += bits;
+            }
+        }
+
+        // Number of selected rows
+        std::size_t count() const
+        {
+            std::size_t result = 0;
+            for(auto w : words_)
+                result += detail::popcount(w);
+            return result;
+        }
+
+        // Call f(row) for every selected row in increasing order
+        template<typename F>
+        void for_each(F&& f) const
+        {
+            for(std::size_t i = 0; i < words_.size(); ++i)
+                for(std::uint64_t w = words_[i]; w != 0; w &= w - 1)
+                    f(i * detail::bitmap_word_bits + detail::countr_zero(w));
+        }
+
+        // Row ids of the selected rows in increasing order
+        std::vector<std::size_t> indices() const
+        {
+            std::vector<std::size_t> result;
+            result.reserve(count());
+            for_each([&result](std::size_t row){ result.push_back(row); });
+            return result;
+        }
+
+        std::vector<std::uint64_t>& words()
+        {
+            return words_;
+        }
+
+        const std::vector<std::uint64_t>& words() const
+        {
+            return words_;
+        }
+
+        selection& operator&=(const selection& other)
+        {
+            check_size(other);
+            for(std::size_t i = 0; i < words_.size(); ++i)
+                words_[i] &= other.words_[i];
+            return *this;
+        }
+
+        selection& operator|=(const selection& other)
+        {
+            check_size(other);
+            for(std::size_t i = 0; i < words_.size(); ++i)
+                words_[i] |= other.words_[i];
+            return *this;
+        }
+
+        friend selection operator&(selection lhs, const selection& rhs)
+        {
+            return lhs &= rhs;
+        }
+
+        friend selection operator|(selection lhs, const selection& rhs)
+        {
+            return lhs |= rhs;
+        }
+
+        friend selection operator~(selection s)
+        {
+            for(auto& w : s.words_)
+                w = ~w;
+            s.clear_padding();
+            return s;
+        }
+
+    private:
+        void check_size(const selection& other) const
+        {
+            if(size_ != other.size_)
+                throw std::invalid_argument("Selections of different sizes");
+        }
+
+        // Bits past size() are kept to 0 so that count() and for_each() don't see them
+        void clear_padding()
+        {
+            if(size_ % detail::bitmap_word_bits != 0)
+                words_.back() &= (std::uint64_t{1} << (size_ % detail::bitmap_word_bits)) - 1;
+        }
+
+        std::vector<std::uint64_t> words_;
+        std::size_t size_ = 0;
+    };
+
+
+    namespace detail
+    {
+        // Evaluate op(p[i], value) for the N first elements of p into bitmap words
+        // Each word is built without branch from 64 comparisons so the inner loop vectorizes
+        template<typename T, typename V, typename Op>
+        void compare_words(const T* p, std::size_t N, const V& value, Op op, std::uint64_t* words)
+        {
+            const std::size_t full = N / bitmap_word_bits;
+            for(std::size_t i = 0; i < full; ++i, p += bitmap_word_bits)
+            {
+                std::uint64_t word = 0;
+                for(std::size_t j = 0; j < bitmap_word_bits; ++j)
+                    word |= static_cast<std::uint64_t>(op(p[j], value)) << j;
+                words[i] = word;
+            }
+            if(N % bitmap_word_bits != 0)
+            {
+                std::uint64_t word = 0;
+                for(std::size_t j = 0; j < N % bitmap_word_bits; ++j)
+                    word |= static_cast<std::uint64_t>(op(p[j], value)) << j;
+                words[full] = word;
+            }
+        }
+
+        template<typename T, typename V, typename Op>
+        selection compare_kernel(const std::vector<T>& data, const V& value, Op op)
+        {
+            selection result(data.size());
+            compare_words(data.data(), data.size(), value, op, result.words().data());
+            return result;
+        }
+
+        // Operators with swapped operands, used for `value < column<T>()`
+        template<typename Op>
+        struct swapped
+        {
+            Op op;
+            template<typename L, typename R>
+            constexpr bool operator()(const L& lhs, const R& rhs) const
+            {
+                return op(rhs, lhs);
+            }
+        };
+
+        // Number of rows of tv, throws if its columns don't have the same size
+        template<typename Tuple>
+        std::size_t row_count(const Tuple& tv)
+        {
+            return std::apply([](const auto& first, const auto&... others)
+                              {
+                                  if(((others.size() != first.size()) or ...))
+                                      throw std::invalid_argument("Columns of different sizes");
+                                  return first.size();
+                              }, tv);
+        }
+
+        // Tag every predicate derives from so that operators only apply to them
+        struct predicate_base {};
+
+        template<typename P>
+        constexpr bool is_predicate_v = std::is_base_of_v<predicate_base, std::decay_t<P>>;
+    }
+
+    // Predicate comparing every element of the column of type T to a value
+    template<typename T, typename V, typename Op>
+    struct comparison : detail::predicate_base
+    {
+        V value;
+        Op op;
+
+        template<typename Tuple>
+        selection evaluate(const Tuple& tv) const
+        {
+            return detail::compare_kernel(get_vector<T>(tv), value, op);
+        }
+    };
+
+    template<typename L, typename R>
+    struct and_predicate : detail::predicate_base
+    {
+        L lhs;
+        R rhs;
+
+        template<typename Tuple>
+        selection evaluate(const Tuple& tv) const
+        {
+            return lhs.evaluate(tv) &= rhs.evaluate(tv);
+        }
+    };
+
+    template<typename L, typename R>
+    struct or_predicate : detail::predicate_base
+    {
+        L lhs;
+        R rhs;
+
+        template<typename Tuple>
+        selection evaluate(const Tuple& tv) const
+        {
+            return lhs.evaluate(tv) |= rhs.evaluate(tv);
+        }
+    };
+
+    template<typename P>
+    struct not_predicate : detail::predicate_base
+    {
+        P pred;
+
+        template<typename Tuple>
+        selection evaluate(const Tuple& tv) const
+        {
+            return ~pred.evaluate(tv);
+        }
+    };
+
+    // Placeholder for the column of type T of the filtered tuple of vectors
+    template<typename T>
+    struct column_ref {};
+
+    template<typename T>
+    constexpr column_ref<T> column()
+    {
+        return {};
+    }
+
+    namespace detail
+    {
+        template<typename T, typename V, typename Op>
+        comparison<T, std::decay_t<V>, Op> make_comparison(V&& value, Op op)
+        {
+            return {{}, std::forward<V>(value), op};
+        }
+    }
+
+    #define FILTER_COMPARISON_OPERATOR(OP, FUNCTOR)                                              \
+        template<typename T, typename V>                                                         \
+        auto operator OP(column_ref<T>, V&& value)                                               \
+        {                                                                                        \
+            return detail::make_comparison<T>(std::forward<V>(value), FUNCTOR{});                \
+        }                                                                                        \
+                                                                                                 \
+        template<typename T, typename V>                                                         \
+        auto operator OP(V&& value, column_ref<T>)                                               \
+            -> std::enable_if_t<!std::is_same_v<std::decay_t<V>, column_ref<T>>,                 \
+                                decltype(detail::make_comparison<T>(std::forward<V>(value),      \
+                                                                    detail::swapped<FUNCTOR>{}))>\
+        {                                                                                        \
+            return detail::make_comparison<T>(std::forward<V>(value), detail::swapped<FUNCTOR>{});\
+        }
+
+    FILTER_COMPARISON_OPERATOR(<, std::less<>)
+    FILTER_COMPARISON_OPERATOR(<=, std::less_equal<>)
+    FILTER_COMPARISON_OPERATOR(>, std::greater<>)
+    FILTER_COMPARISON_OPERATOR(>=, std::greater_equal<>)
+    FILTER_COMPARISON_OPERATOR(==, std::equal_to<>)
+    FILTER_COMPARISON_OPERATOR(!=, std::not_equal_to<>)
+
+    // Don't pollute global namespace
+    #undef FILTER_COMPARISON_OPERATOR
+
+    template<typename L, typename R,
+             typename = std::enable_if_t<detail::is_predicate_v<L> and detail::is_predicate_v<R>>>
+    and_predicate<std::decay_t<L>, std::decay_t<R>> operator&&(L&& lhs, R&& rhs)
+    {
+        return {{}, std::forward<L>(lhs), std::forward<R>(rhs)};
+    }
+
+    template<typename L, typename R,
+             typename = std::enable_if_t<detail::is_predicate_v<L> and detail::is_predicate_v<R>>>
+    or_predicate<std::decay_t<L>, std::decay_t<R>> operator||(L&& lhs, R&& rhs)
+    {
+        return {{}, std::forward<L>(lhs), std::forward<R>(rhs)};
+    }
+
+    template<typename P, typename = std::enable_if_t<detail::is_predicate_v<P>>>
+    not_predicate<std::decay_t<P>> operator!(P&& pred)
+    {
+        return {{}, std::forward<P>(pred)};
+    }
+
+
+    // Selection of the rows of tv matching a predicate
+    template<typename Tuple, typename Predicate>
+    selection select(const Tuple& tv, const Predicate& pred)
+    {
+        detail::row_count(tv);
+        return pred.evaluate(tv);
+    }
+
+
+    /*
+     * Lazy view of the rows of a tuple of vectors that are in a selection, iterating over it
+     * gives row views (see get_row) without copying anything
+     */
+    template<typename Tuple>
+    class selection_view
+    {
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = decltype(get_row(std::declval<Tuple&>(), 0));
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            iterator() = default;
+
+            iterator(Tuple* tv, const selection* sel, std::size_t word)
+                : tv_(tv), sel_(sel), word_(word)
+            {
+                load_word();
+            }
+
+            reference operator*() const
+            {
+                return get_row(*tv_, row());
+            }
+
+            iterator& operator++()
+            {
+                bits_ &= bits_ - 1;
+                if(bits_ == 0)
+                {
+                    ++word_;
+                    load_word();
+                }
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                iterator old = *this;
+                ++*this;
+                return old;
+            }
+
+            // Row id in the underlying tuple of vectors
+            std::size_t row() const
+            {
+                return word_ * detail::bitmap_word_bits + detail::countr_zero(bits_);
+            }
+
+            friend bool operator==(const iterator& lhs, const iterator& rhs)
+            {
+                return lhs.word_ == rhs.word_ and lhs.bits_ == rhs.bits_;
+            }
+
+            friend bool operator!=(const iterator& lhs, const iterator& rhs)
+            {
+                return !(lhs == rhs);
+            }
+
+        private:
+            // Skip empty words, stops at the end of the bitmap
+            void load_word()
+            {
+                const auto& words = sel_->words();
+                while(word_ < words.size() and words[word_] == 0)
+                    ++word_;
+                bits_ = word_ < words.size() ? words[word_] : 0;
+            }
+
+            Tuple* tv_ = nullptr;
+            const selection* sel_ = nullptr;
+            std::size_t word_ = 0;
+            std::uint64_t bits_ = 0;
+        };
+
+        selection_view(Tuple& tv, selection sel)
+            : tv_(&tv), sel_(std::move(sel))
+        {}
+
+        iterator begin() const
+        {
+            return iterator(tv_, &sel_, 0);
+        }
+
+        iterator end() const
+        {
+            return iterator(tv_, &sel_, sel_.words().size());
+        }
+
+        // Number of selected rows
+        std::size_t size() const
+        {
+            return sel_.count();
+        }
+
+        const selection& rows() const
+        {
+            return sel_;
+        }
+
+    private:
+        Tuple* tv_;
+        selection sel_;
+    };
+
+    template<typename Tuple, typename Predicate>
+    selection_view<Tuple> select_view(Tuple& tv, const Predicate& pred)
+    {
+        return selection_view<Tuple>(tv, select(tv, pred));
+    }
+
+
+    // Copy the selected rows of every column of tv in a new tuple of vectors
+    namespace detail
+    {
+        template<typename T>
+        std::vector<T> gather(const std::vector<T>& column, const selection& sel, std::size_t count)
+        {
+            std::vector<T> result;
+            result.reserve(count);
+            sel.for_each([&](std::size_t row){ result.push_back(column[row]); });
+            return result;
+        }
+    }
+
+    template<typename... Ts>
+    std::tuple<std::vector<Ts>...> gather(const std::tuple<std::vector<Ts>...>& tv, const selection& sel)
+    {
+        if(detail::row_count(tv) != sel.size())
+            throw std::invalid_argument("Selection and columns of different sizes");
+        const std::size_t count = sel.count();
+        return std::apply([&](const auto&... columns)
+                          {
+                              return std::make_tuple(detail::gather(columns, sel, count)...);
+                          }, tv);
+    }
+
+    // Rows of tv matching a predicate, as a new tuple of vectors
+    template<typename Tuple, typename Predicate>
+    auto filter(const Tuple& tv, const Predicate& pred)
+    {
+        return gather(tv, select(tv, pred));
+    }
+}
+#endif //FILTER_CPP17_HPP
@@ -0,0 +1,170 @@
+#ifndef GENERATE_CPP17_HPP
+#define GENERATE_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include "parallel-cpp17.hpp"
+#include <functional>
+
+
+namespace test
+{
+    /*
+     * Counterpart of vectorize for computed values : the columns are filled from generators in a
+     * single pass, instead of being filled with a copy of one value and overwritten.
+     *   // One generator returning the whole row
+     *   auto tv = test::vectorize_generate(N, [](std::size_t i){ return std::make_tuple(int(i), i * 0.5); });
+     *   // One generator per column
+     *   auto tv = test::vectorize_generate(N, std::make_tuple([](std::size_t i){ return int(i); },
+     *                                                         [](std::size_t i){ return i * 0.5; }));
+     * Generators may return test::named values to get named columns.
+     * Rows are generated chunk by chunk, every column of a chunk being filled before the next
+     * chunk. Columns are written through plain pointer stores, which the compiler can vectorize
+     * for simple per-column generators : with one thread (the default) the vectors are grown one
+     * chunk at a time, the value-initialization of a chunk staying in cache until it is
+     * overwritten, so memory is written once. With several threads (the generators must then be
+     * callable concurrently) the vectors are sized first and each thread fills a contiguous
+     * range. Element types that aren't default constructible, and bool, are appended one by one
+     * by a single thread.
+     */
+    namespace detail
+    {
+        constexpr std::size_t generate_chunk = 4096;
+
+        // Column type holding the values returned by a generator
+        template<typename T>
+        struct generated_column
+        {
+            using type = std::vector<T>;
+        };
+
+        template<typename Name, typename T>
+        struct generated_column<named_value<Name, T>>
+        {
+            using type = named_vector<Name, T>;
+        };
+
+        template<typename T>
+        using generated_column_t = typename generated_column<std::decay_t<T>>::type;
+
+        template<typename T>
+        T&& column_value(T&& value)
+        {
+            return std::forward<T>(value);
+        }
+
+        template<typename Name, typename T>
+        T&& column_value(named_value<Name, T>&& value)
+        {
+            return std::move(value.value);
+        }
+
+        // Columns that can be sized before being written, std::vector<bool> has no data() and
+        // threads can't write to its neighbouring elements
+        template<typename Columns>
+        struct indexed_fill;
+
+        template<typename... Columns>
+        struct indexed_fill<std::tuple<Columns...>>
+        {
+            static constexpr bool value = ((std::is_default_constructible_v<typename Columns::value_type>
+                                            and !std::is_same_v<typename Columns::value_type, bool>) and ...);
+        };
+
+        // fill_chunk(columns, begin, end) writes the rows [begin, end), by index if the columns
+        // are indexed_fill (they are already big enough) or by appending them otherwise
+        template<typename Columns, typename FillChunk>
+        Columns generate(std::size_t N, unsigned threads, FillChunk&& fill_chunk)
+        {
+            constexpr bool indexed = indexed_fill<Columns>::value;
+            Columns columns;
+            const bool sequential = !indexed or thread_count(N, threads) == 1;
+            std::apply([&](auto&... column){ (column.reserve(N), ...); }, columns);
+
+            if(sequential)
+                for(std::size_t chunk = 0; chunk < N; chunk += generate_chunk)
+                {
+                    const std::size_t end = std::min(N, chunk + generate_chunk);
+                    if constexpr(indexed)
+                        std::apply([&](auto&... column){ (column.resize(end), ...); }, columns);
+                    fill_chunk(columns, chunk, end);
+                }
+            else if constexpr(indexed)
+            {
+                std::apply([&](auto&... column){ (column.resize(N), ...); }, columns);
+                parallel_for_chunks(N, threads, [&](unsigned, std::size_t begin, std::size_t end)
+                {
+                    for(std::size_t chunk = begin; chunk < end; chunk += generate_chunk)
+                        fill_chunk(columns, chunk, std::min(end, chunk + generate_chunk));
+                });
+            }
+            return columns;
+        }
+
+        template<typename F, std::size_t... I>
+        auto generate_rows(std::size_t N, F& f, unsigned threads, std::index_sequence<I...>)
+        {
+            using row_type = std::decay_t<std::invoke_result_t<F&, std::size_t>>;
+            using columns_type = std::tuple<generated_column_t<std::tuple_element_t<I, row_type>>...>;
+
+            return generate<columns_type>(N, threads, [&f](columns_type& columns, std::size_t begin, std::size_t end)
+            {
+                if constexpr(indexed_fill<columns_type>::value)
+                {
+                    const auto out = std::make_tuple(std::get<I>(columns).data()...);
+                    for(std::size_t i = begin; i < end; ++i)
+                    {
+                        row_type row = f(i);
+                        ((std::get<I>(out)[i] = column_value(std::get<I>(std::move(row)))), ...);
+                    }
+                }
+                else
+                    for(std::size_t i = begin; i < end; ++i)
+                    {
+                        row_type row = f(i);
+                        (std::get<I>(columns).push_back(column_value(std::get<I>(std::move(row)))), ...);
+                    }
+            });
+        }
+
+        template<typename... Fs, std::size_t... I>
+        auto generate_columns(std::size_t N, std::tuple<Fs...>& generators, unsigned threads,
+                              std::index_sequence<I...>)
+        {
+            using columns_type = std::tuple<generated_column_t<std::invoke_result_t<Fs&, std::size_t>>...>;
+
+            return generate<columns_type>(N, threads,
+                                          [&generators](columns_type& columns, std::size_t begin, std::size_t end)
+            {
+                auto fill_column = [&](auto& column, auto& generator)
+                {
+                    if constexpr(indexed_fill<columns_type>::value)
+                    {
+                        auto* out = column.data();
+                        for(std::size_t i = begin; i < end; ++i)
+                            out[i] = column_value(generator(i));
+                    }
+                    else
+                        for(std::size_t i = begin; i < end; ++i)
+                            column.push_back(column_value(generator(i)));
+                };
+                (fill_column(std::get<I>(columns), std::get<I>(generators)), ...);
+            });
+        }
+    }
+
+    // f(i) returns the i-th row as a tuple, threads = 0 means as many as the hardware offers
+    template<typename F>
+    auto vectorize_generate(std::size_t N, F f, unsigned threads = 1)
+    {
+        using row_type = std::decay_t<std::invoke_result_t<F&, std::size_t>>;
+        return detail::generate_rows(N, f, threads, std::make_index_sequence<std::tuple_size_v<row_type>>{});
+    }
+
+    // std::get<I>(generators)(i) returns the i-th element of the I-th column
+    template<typename... Fs>
+    auto vectorize_generate(std::size_t N, std::tuple<Fs...> generators, unsigned threads = 1)
+    {
+        return detail::generate_columns(N, generators, threads, std::index_sequence_for<Fs...>{});
+    }
+}
+#endif //GENERATE_CPP17_HPP
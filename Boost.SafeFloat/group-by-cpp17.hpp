@@ -0,0 +1,300 @@
+#ifndef GROUP_BY_CPP17_HPP
+#define GROUP_BY_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include "parallel-cpp17.hpp"
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+
+
+namespace test
+{
+    /*
+     * Group-by and aggregation over a tuple of vectors :
+     *   test::group_by<int>(tv).aggregate(test::sum<double>(), test::min<float>(), test::count())
+     * The result is itself a tuple of vectors, the first one holds the keys and the following
+     * ones the aggregated values, one per aggregate.
+     * By default a hash aggregation is done, each thread aggregates a chunk of the rows in its
+     * own table and the tables are merged at the end (groups come out in no particular order).
+     * When the key column is known to be sorted, presorted() switches to a single scan over the
+     * runs of equal keys which keeps the groups in key order.
+     * Aggregated columns must have the size of the key column, std::invalid_argument is thrown
+     * otherwise.
+     */
+
+    namespace detail
+    {
+        template<typename T, typename Tuple>
+        void check_column_size(const Tuple& tv, std::size_t rows)
+        {
+            if(get_vector<T>(tv).size() != rows)
+                throw std::invalid_argument("Aggregated column and key column of different sizes");
+        }
+    }
+
+    // Every aggregate provides :
+    //   state_type                        the type of the aggregated value
+    //   first(tv, row) -> state_type      the state of a group whose first row is row
+    //   update(state, tv, row)            add a row to a group
+    //   merge(state, other)               merge two partial states of the same group
+    //   check(tv, rows)                   throws if the column read doesn't have rows elements
+    template<typename T>
+    struct sum_aggregate
+    {
+        using state_type = decltype(std::declval<T>() + std::declval<T>());
+
+        template<typename Tuple>
+        state_type first(const Tuple& tv, std::size_t row) const
+        {
+            return get_vector<T>(tv)[row];
+        }
+
+        template<typename Tuple>
+        void update(state_type& state, const Tuple& tv, std::size_t row) const
+        {
+            state += get_vector<T>(tv)[row];
+        }
+
+        void merge(state_type& state, const state_type& other) const
+        {
+            state += other;
+        }
+
+        template<typename Tuple>
+        void check(const Tuple& tv, std::size_t rows) const
+        {
+            detail::check_column_size<T>(tv, rows);
+        }
+    };
+
+    template<typename T, typename Compare>
+    struct extremum_aggregate
+    {
+        using state_type = T;
+
+        template<typename Tuple>
+        state_type first(const Tuple& tv, std::size_t row) const
+        {
+            return get_vector<T>(tv)[row];
+        }
+
+        template<typename Tuple>
+        void update(state_type& state, const Tuple& tv, std::size_t row) const
+        {
+            merge(state, get_vector<T>(tv)[row]);
+        }
+
+        void merge(state_type& state, const state_type& other) const
+        {
+            if(Compare{}(other, state))
+                state = other;
+        }
+
+        template<typename Tuple>
+        void check(const Tuple& tv, std::size_t rows) const
+        {
+            detail::check_column_size<T>(tv, rows);
+        }
+    };
+
+    struct count_aggregate
+    {
+        using state_type = std::size_t;
+
+        template<typename Tuple>
+        state_type first(const Tuple&, std::size_t) const
+        {
+            return 1;
+        }
+
+        template<typename Tuple>
+        void update(state_type& state, const Tuple&, std::size_t) const
+        {
+            ++state;
+        }
+
+        void merge(state_type& state, const state_type& other) const
+        {
+            state += other;
+        }
+
+        template<typename Tuple>
+        void check(const Tuple&, std::size_t) const
+        {}
+    };
+
+    template<typename T>
+    constexpr sum_aggregate<T> sum()
+    {
+        return {};
+    }
+
+    template<typename T>
+    constexpr extremum_aggregate<T, std::less<T>> min()
+    {
+        return {};
+    }
+
+    template<typename T>
+    constexpr extremum_aggregate<T, std::greater<T>> max()
+    {
+        return {};
+    }
+
+    constexpr count_aggregate count()
+    {
+        return {};
+    }
+
+
+    namespace detail
+    {
+        template<typename Tuple, typename... Aggs, std::size_t... I>
+        auto first_states(const std::tuple<Aggs...>& aggs, const Tuple& tv, std::size_t row,
+                          std::index_sequence<I...>)
+        {
+            return std::make_tuple(std::get<I>(aggs).first(tv, row)...);
+        }
+
+        template<typename Tuple, typename... Aggs, std::size_t... I>
+        void update_states(const std::tuple<Aggs...>& aggs,
+                           std::tuple<typename Aggs::state_type...>& states,
+                           const Tuple& tv, std::size_t row, std::index_sequence<I...>)
+        {
+            (std::get<I>(aggs).update(std::get<I>(states), tv, row), ...);
+        }
+
+        template<typename... Aggs, std::size_t... I>
+        void merge_states(const std::tuple<Aggs...>& aggs,
+                          std::tuple<typename Aggs::state_type...>& states,
+                          const std::tuple<typename Aggs::state_type...>& others,
+                          std::index_sequence<I...>)
+        {
+            (std::get<I>(aggs).merge(std::get<I>(states), std::get<I>(others)), ...);
+        }
+
+        template<typename Key, typename... States, std::size_t... I>
+        void append_group(std::tuple<std::vector<Key>, std::vector<States>...>& result,
+                          const Key& key, std::tuple<States...>&& states, std::index_sequence<I...>)
+        {
+            std::get<0>(result).push_back(key);
+            (std::get<I + 1>(result).push_back(std::move(std::get<I>(states))), ...);
+        }
+    }
+
+
+    template<typename Key, typename Tuple, typename Hash = std::hash<Key>>
+    class grouped
+    {
+    public:
+        explicit grouped(const Tuple& tv)
+            : tv_(&tv)
+        {}
+
+        // Number of threads used by the hash aggregation (0 means as many as the hardware offers)
+        grouped& threads(unsigned count)
+        {
+            threads_ = count;
+            return *this;
+        }
+
+        // Tells that the key column is sorted (equal keys are contiguous is enough)
+        grouped& presorted(bool value = true)
+        {
+            presorted_ = value;
+            return *this;
+        }
+
+        template<typename... Aggs>
+        auto aggregate(Aggs... aggs) const
+        {
+            const std::tuple<Aggs...> agg_tuple(aggs...);
+            const std::size_t rows = get_vector<Key>(*tv_).size();
+            (aggs.check(*tv_, rows), ...);
+            return presorted_ ? sort_aggregate(agg_tuple) : hash_aggregate(agg_tuple);
+        }
+
+    private:
+        template<typename... Aggs>
+        using result_type = std::tuple<std::vector<Key>, std::vector<typename Aggs::state_type>...>;
+
+        template<typename... Aggs>
+        result_type<Aggs...> hash_aggregate(const std::tuple<Aggs...>& aggs) const
+        {
+            using states_type = std::tuple<typename Aggs::state_type...>;
+            using table_type = std::unordered_map<Key, states_type, Hash>;
+            constexpr auto seq = std::index_sequence_for<Aggs...>{};
+
+            const auto& keys = get_vector<Key>(*tv_);
+            const unsigned count = detail::thread_count(keys.size(), threads_);
+
+            // Thread local partial tables
+            std::vector<table_type> partials(count);
+            detail::parallel_for_chunks(keys.size(), count,
+                [&](unsigned id, std::size_t begin, std::size_t end)
+                {
+                    auto& table = partials[id];
+                    for(std::size_t row = begin; row < end; ++row)
+                    {
+                        auto it = table.find(keys[row]);
+                        if(it == table.end())
+                            table.emplace(keys[row], detail::first_states(aggs, *tv_, row, seq));
+                        else
+                            detail::update_states(aggs, it->second, *tv_, row, seq);
+                    }
+                });
+
+            // Merge everything in the first table
+            auto& merged = partials.front();
+            for(unsigned i = 1; i < count; ++i)
+                for(auto& [key, states] : partials[i])
+                {
+                    auto it = merged.find(key);
+                    if(it == merged.end())
+                        merged.emplace(key, std::move(states));
+                    else
+                        detail::merge_states(aggs, it->second, states, seq);
+                }
+
+            result_type<Aggs...> result;
+            std::apply([&](auto&... columns){ (columns.reserve(merged.size()), ...); }, result);
+            for(auto& [key, states] : merged)
+                detail::append_group(result, key, std::move(states), seq);
+            return result;
+        }
+
+        template<typename... Aggs>
+        result_type<Aggs...> sort_aggregate(const std::tuple<Aggs...>& aggs) const
+        {
+            constexpr auto seq = std::index_sequence_for<Aggs...>{};
+            const auto& keys = get_vector<Key>(*tv_);
+
+            result_type<Aggs...> result;
+            std::size_t row = 0;
+            while(row < keys.size())
+            {
+                // One run of equal keys is one group
+                auto states = detail::first_states(aggs, *tv_, row, seq);
+                std::size_t end = row + 1;
+                for(; end < keys.size() and keys[end] == keys[row]; ++end)
+                    detail::update_states(aggs, states, *tv_, end, seq);
+                detail::append_group(result, keys[row], std::move(states), seq);
+                row = end;
+            }
+            return result;
+        }
+
+        const Tuple* tv_;
+        unsigned threads_ = 0;
+        bool presorted_ = false;
+    };
+
+    // Group the rows of tv by the values of its column of type Key
+    template<typename Key, typename Tuple>
+    grouped<Key, Tuple> group_by(const Tuple& tv)
+    {
+        return grouped<Key, Tuple>(tv);
+    }
+}
+#endif //GROUP_BY_CPP17_HPP
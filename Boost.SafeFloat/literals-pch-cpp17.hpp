@@ -0,0 +1,59 @@
+#ifndef LITERALS_PCH_CPP17_HPP
+#define LITERALS_PCH_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+
+
+namespace test
+{
+    /*
+     * Header meant to be precompiled (see CMakeLists.txt) by targets using many _sf/_sd/_sld
+     * literals : the tables of the powers of 0.5 are computed and the most common spellings of
+     * the literals are instantiated once, when the header is precompiled, instead of in every
+     * translation unit.
+     * Instantiations are done by using the literals rather than by explicit instantiation
+     * definitions, which may appear only once in a program.
+     */
+    namespace detail
+    {
+        inline constexpr float instantiated_sf[] = {
+            pow_of_0_5s<float>.values[1],
+            literal::operator""_sf<'0', '.', '5'>(),
+            literal::operator""_sf<'0', '.', '2', '5'>(),
+            literal::operator""_sf<'0', '.', '1', '2', '5'>(),
+            literal::operator""_sf<'0', '.', '0', '6', '2', '5'>(),
+            literal::operator""_sf<'0', '.', '0', '3', '1', '2', '5'>(),
+            literal::operator""_sf<'0', 'x', '1', 'p', '-', '1'>(),
+            literal::operator""_sf<'0', 'x', '1', 'p', '-', '2'>(),
+            literal::operator""_sf<'0', 'x', '1', 'p', '-', '3'>(),
+            literal::operator""_sf<'0', 'x', '1', 'p', '-', '4'>()
+        };
+
+        inline constexpr double instantiated_sd[] = {
+            pow_of_0_5s<double>.values[1],
+            literal::operator""_sd<'0', '.', '5'>(),
+            literal::operator""_sd<'0', '.', '2', '5'>(),
+            literal::operator""_sd<'0', '.', '1', '2', '5'>(),
+            literal::operator""_sd<'0', '.', '0', '6', '2', '5'>(),
+            literal::operator""_sd<'0', '.', '0', '3', '1', '2', '5'>(),
+            literal::operator""_sd<'0', 'x', '1', 'p', '-', '1'>(),
+            literal::operator""_sd<'0', 'x', '1', 'p', '-', '2'>(),
+            literal::operator""_sd<'0', 'x', '1', 'p', '-', '3'>(),
+            literal::operator""_sd<'0', 'x', '1', 'p', '-', '4'>()
+        };
+
+        inline constexpr long double instantiated_sld[] = {
+            pow_of_0_5s<long double>.values[1],
+            literal::operator""_sld<'0', '.', '5'>(),
+            literal::operator""_sld<'0', '.', '2', '5'>(),
+            literal::operator""_sld<'0', '.', '1', '2', '5'>(),
+            literal::operator""_sld<'0', '.', '0', '6', '2', '5'>(),
+            literal::operator""_sld<'0', '.', '0', '3', '1', '2', '5'>(),
+            literal::operator""_sld<'0', 'x', '1', 'p', '-', '1'>(),
+            literal::operator""_sld<'0', 'x', '1', 'p', '-', '2'>(),
+            literal::operator""_sld<'0', 'x', '1', 'p', '-', '3'>(),
+            literal::operator""_sld<'0', 'x', '1', 'p', '-', '4'>()
+        };
+    }
+}
+#endif //LITERALS_PCH_CPP17_HPP
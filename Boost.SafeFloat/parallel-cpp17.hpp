@@ -0,0 +1,50 @@
+#ifndef PARALLEL_CPP17_HPP
+#define PARALLEL_CPP17_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+
+namespace test
+{
+    namespace detail
+    {
+        // Below this number of elements per thread, spawning threads costs more than it saves
+        constexpr std::size_t min_parallel_chunk = 1 << 14;
+
+        // Number of threads to use for N elements when the user asked for `threads` (0 means as
+        // many as the hardware offers)
+        inline unsigned thread_count(std::size_t N, unsigned threads)
+        {
+            if(threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            const std::size_t useful = std::max<std::size_t>(1, N / min_parallel_chunk);
+            return static_cast<unsigned>(std::min<std::size_t>(threads, useful));
+        }
+
+        // Split [0, N) in contiguous chunks and call f(thread_id, begin, end) for each of them,
+        // the calling thread handles the first chunk
+        template<typename F>
+        void parallel_for_chunks(std::size_t N, unsigned threads, F&& f)
+        {
+            const unsigned count = thread_count(N, threads);
+            const std::size_t chunk = (N + count - 1) / count;
+
+            std::vector<std::thread> workers;
+            workers.reserve(count - 1);
+            for(unsigned i = 1; i < count; ++i)
+            {
+                const std::size_t begin = std::min(N, i * chunk);
+                const std::size_t end = std::min(N, begin + chunk);
+                workers.emplace_back([&f, i, begin, end]{ f(i, begin, end); });
+            }
+            f(0u, std::size_t{0}, std::min(N, chunk));
+
+            for(auto& w : workers)
+                w.join();
+        }
+    }
+}
+#endif //PARALLEL_CPP17_HPP
@@ -0,0 +1,71 @@
+#ifndef PARSE_POW_OF_0_5_CPP17_HPP
+#define PARSE_POW_OF_0_5_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include <cctype>
+#include <charconv>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+
+namespace test
+{
+    /*
+     * Runtime counterpart of the literals, for values that aren't known at compile time (read
+     * from a file for instance). Same grammar (decimal or hex floating point number without
+     * suffix) and same rule (positive power of 0.5), returns the value if the text satisfies both.
+     * Kept out of competency-test-cpp17.hpp so that its includers don't pay for <charconv>.
+     */
+    namespace detail
+    {
+        // Checks the grammar accepted by the literal parser, without computing the value
+        constexpr bool is_literal_syntax(std::string_view s)
+        {
+            const bool hex = s.size() > 2 and s[0] == '0' and (s[1] == 'x' or s[1] == 'X');
+            std::size_t i = hex ? 2 : 0;
+            std::size_t digits = 0;
+            const auto is_mantissa_digit = [hex](char c){ return hex ? isxdigit(c) : isdigit(c); };
+
+            for(; i < s.size() and is_mantissa_digit(s[i]); ++i)
+                ++digits;
+            if(i < s.size() and s[i] == '.')
+                for(++i; i < s.size() and is_mantissa_digit(s[i]); ++i)
+                    ++digits;
+            if(digits == 0)
+                return false;
+
+            // Exponent, mandatory for hex numbers
+            if(i == s.size())
+                return !hex;
+            if(hex ? (s[i] != 'p' and s[i] != 'P') : (s[i] != 'e' and s[i] != 'E'))
+                return false;
+            ++i;
+            if(i < s.size() and (s[i] == '+' or s[i] == '-'))
+                ++i;
+            if(i == s.size())
+                return false;
+            for(; i < s.size(); ++i)
+                if(!isdigit(s[i]))
+                    return false;
+            return true;
+        }
+    }
+
+    template<typename RT>
+    std::optional<RT> parse_pow_of_0_5(std::string_view s)
+    {
+        if(!detail::is_literal_syntax(s))
+            return std::nullopt;
+
+        const bool hex = s.size() > 2 and s[0] == '0' and (s[1] == 'x' or s[1] == 'X');
+        const char* first = s.data() + (hex ? 2 : 0);
+        RT value{};
+        const auto [end, error] = std::from_chars(first, s.data() + s.size(), value,
+                                                  hex ? std::chars_format::hex : std::chars_format::general);
+        if(error != std::errc{} or end != s.data() + s.size() or !detail::is_pow_of_0_5(value))
+            return std::nullopt;
+        return value;
+    }
+}
+#endif //PARSE_POW_OF_0_5_CPP17_HPP
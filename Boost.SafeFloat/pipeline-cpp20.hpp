@@ -0,0 +1,589 @@
+#ifndef PIPELINE_CPP20_HPP
+#define PIPELINE_CPP20_HPP
+
+#include "competency-test-cpp17.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+
+namespace test
+{
+    /*
+     * Pipelines of coroutine stages over column batches. A batch is a slice of the tuple of
+     * vectors layout used by vectorize, stages exchange batches through bounded channels :
+     *   test::thread_pool pool;
+     *   test::channel<test::column_batch<int, double>> raw(pool, 4), kept(pool, 4);
+     *   test::pipeline p(pool);
+     *   p.add(test::send_batches(tv, 4096, raw));
+     *   p.add(test::transform_batches(raw, kept, filter_kernel));
+     *   p.add(test::receive_batches(kept, result));
+     *   p.wait();
+     * Stages start in wait(), once every stage of the pipeline is created : the ready-made stages
+     * register with their output channel when they are created, a channel fed by several stages
+     * (fan-in, or a transform run by several stages for fan-out) is then closed only when all of
+     * them are done.
+     * A stage sending to a full channel is suspended until a batch is received (backpressure),
+     * so at most capacity batches are waiting between two stages whatever the size of the
+     * table. Suspended stages don't hold a thread : any number of stages runs on the threads of
+     * the pool, and the stages run concurrently as soon as there are batches for them.
+     * Arguments of the stages are taken by reference and must outlive the pipeline.
+     */
+    class thread_pool
+    {
+    public:
+        // 0 means as many threads as the hardware offers
+        explicit thread_pool(unsigned threads = 0)
+        {
+            if(threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            workers_.reserve(threads);
+            for(unsigned i = 0; i < threads; ++i)
+                workers_.emplace_back([this]{ run(); });
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        // Coroutines already posted are resumed before the threads stop
+        ~thread_pool()
+        {
+            {
+                std::lock_guard lock(mutex_);
+                stopping_ = true;
+            }
+            wake_.notify_all();
+            for(auto& w : workers_)
+                w.join();
+        }
+
+        // Resume h on one of the threads of the pool
+        void post(std::coroutine_handle<> h)
+        {
+            {
+                std::lock_guard lock(mutex_);
+                queue_.push_back(h);
+            }
+            wake_.notify_one();
+        }
+
+        // co_await pool.schedule() moves the rest of the coroutine to the pool
+        auto schedule()
+        {
+            struct awaiter
+            {
+                thread_pool& pool;
+
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> h) { pool.post(h); }
+                void await_resume() const noexcept {}
+            };
+            return awaiter{*this};
+        }
+
+    private:
+        void run()
+        {
+            for(;;)
+            {
+                std::coroutine_handle<> h;
+                {
+                    std::unique_lock lock(mutex_);
+                    wake_.wait(lock, [this]{ return stopping_ or !queue_.empty(); });
+                    if(queue_.empty())
+                        return;
+                    h = queue_.front();
+                    queue_.pop_front();
+                }
+                h.resume();
+            }
+        }
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::deque<std::coroutine_handle<>> queue_;
+        bool stopping_ = false;
+        std::vector<std::thread> workers_;
+    };
+
+
+    /*
+     * Bounded multi-producer multi-consumer channel :
+     *   co_await out.send(batch)    false if the channel was closed, the batch is then dropped
+     *   co_await in.receive()       std::optional, empty once the channel is closed and drained
+     * Stages sending to the channel register with add_producer() and leave with producer_done(),
+     * the channel closes when the last one leaves, so that several stages can feed it.
+     * Waiting coroutines are resumed on the pool, never inside send/receive/close.
+     */
+    template<typename T>
+    class channel
+    {
+    public:
+        channel(thread_pool& pool, std::size_t capacity)
+            : pool_(pool), capacity_(std::max<std::size_t>(1, capacity))
+        {}
+
+        channel(const channel&) = delete;
+        channel& operator=(const channel&) = delete;
+
+        class send_awaiter
+        {
+        public:
+            bool await_ready() const noexcept { return false; }
+
+            // Everything is decided under the lock, the awaiter lives in the coroutine frame and
+            // can't be touched once another thread may resume the coroutine
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                std::coroutine_handle<> wake;
+                {
+                    std::lock_guard lock(channel_.mutex_);
+                    if(channel_.closed_)
+                    {
+                        sent_ = false;
+                        return false;
+                    }
+                    if(!channel_.receivers_.empty())
+                    {
+                        // A receiver waits, so the buffer is empty : hand the value over directly
+                        auto* receiver = channel_.receivers_.front();
+                        channel_.receivers_.pop_front();
+                        receiver->value_ = std::move(value_);
+                        wake = receiver->handle_;
+                    }
+                    else if(channel_.buffer_.size() < channel_.capacity_)
+                        channel_.buffer_.push_back(std::move(value_));
+                    else
+                    {
+                        handle_ = h;
+                        channel_.senders_.push_back(this);
+                        return true;
+                    }
+                }
+                if(wake)
+                    channel_.pool_.post(wake);
+                return false;
+            }
+
+            bool await_resume() const noexcept
+            {
+                return sent_;
+            }
+
+        private:
+            friend class channel;
+
+            send_awaiter(channel& c, T value)
+                : channel_(c), value_(std::move(value))
+            {}
+
+            channel& channel_;
+            T value_;
+            bool sent_ = true;
+            std::coroutine_handle<> handle_;
+        };
+
+        class receive_awaiter
+        {
+        public:
+            bool await_ready() const noexcept { return false; }
+
+            bool await_suspend(std::coroutine_handle<> h)
+            {
+                std::coroutine_handle<> wake;
+                {
+                    std::lock_guard lock(channel_.mutex_);
+                    if(!channel_.buffer_.empty())
+                    {
+                        value_ = std::move(channel_.buffer_.front());
+                        channel_.buffer_.pop_front();
+                        // Room was made, the first waiting sender can complete
+                        if(!channel_.senders_.empty())
+                        {
+                            auto* sender = channel_.senders_.front();
+                            channel_.senders_.pop_front();
+                            channel_.buffer_.push_back(std::move(sender->value_));
+                            wake = sender->handle_;
+                        }
+                    }
+                    else if(!channel_.closed_)
+                    {
+                        handle_ = h;
+                        channel_.receivers_.push_back(this);
+                        return true;
+                    }
+                }
+                if(wake)
+                    channel_.pool_.post(wake);
+                return false;
+            }
+
+            std::optional<T> await_resume()
+            {
+                return std::move(value_);
+            }
+
+        private:
+            friend class channel;
+
+            explicit receive_awaiter(channel& c)
+                : channel_(c)
+            {}
+
+            channel& channel_;
+            std::optional<T> value_;
+            std::coroutine_handle<> handle_;
+        };
+
+        send_awaiter send(T value)
+        {
+            return send_awaiter(*this, std::move(value));
+        }
+
+        receive_awaiter receive()
+        {
+            return receive_awaiter(*this);
+        }
+
+        void add_producer()
+        {
+            std::lock_guard lock(mutex_);
+            ++producers_;
+        }
+
+        // Closes the channel when no registered producer is left
+        void producer_done()
+        {
+            bool last;
+            {
+                std::lock_guard lock(mutex_);
+                last = --producers_ == 0;
+            }
+            if(last)
+                close();
+        }
+
+        // No more sends : receivers drain what is buffered then get an empty optional, pending
+        // sends fail. Called when the last producer is done, or to stop the producers early
+        void close()
+        {
+            std::vector<std::coroutine_handle<>> wake;
+            {
+                std::lock_guard lock(mutex_);
+                if(closed_)
+                    return;
+                closed_ = true;
+                for(auto* receiver : receivers_)
+                    wake.push_back(receiver->handle_);
+                for(auto* sender : senders_)
+                {
+                    sender->sent_ = false;
+                    wake.push_back(sender->handle_);
+                }
+                receivers_.clear();
+                senders_.clear();
+            }
+            for(auto h : wake)
+                pool_.post(h);
+        }
+
+    private:
+        thread_pool& pool_;
+        const std::size_t capacity_;
+        std::mutex mutex_;
+        std::deque<T> buffer_;
+        std::deque<send_awaiter*> senders_;
+        std::deque<receive_awaiter*> receivers_;
+        std::size_t producers_ = 0;
+        bool closed_ = false;
+    };
+
+
+    class pipeline;
+
+    // Coroutine type of the stages, started by the pipeline they are added to
+    class stage
+    {
+    public:
+        struct promise_type
+        {
+            pipeline* owner = nullptr;
+            std::exception_ptr error;
+
+            stage get_return_object()
+            {
+                return stage(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            // Tells the pipeline, the frame stays alive until the pipeline is destroyed
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+                void await_resume() const noexcept {}
+            };
+
+            final_awaiter final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void() {}
+
+            void unhandled_exception()
+            {
+                error = std::current_exception();
+            }
+        };
+
+        stage(stage&& other) noexcept
+            : handle_(std::exchange(other.handle_, nullptr))
+        {}
+
+        stage& operator=(stage&&) = delete;
+
+        ~stage()
+        {
+            if(handle_)
+                handle_.destroy();
+        }
+
+    private:
+        friend class pipeline;
+
+        explicit stage(std::coroutine_handle<promise_type> h)
+            : handle_(h)
+        {}
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+
+    class pipeline
+    {
+    public:
+        explicit pipeline(thread_pool& pool)
+            : pool_(pool)
+        {}
+
+        pipeline(const pipeline&) = delete;
+        pipeline& operator=(const pipeline&) = delete;
+
+        ~pipeline()
+        {
+            std::unique_lock lock(mutex_);
+            done_.wait(lock, [this]{ return running_ == 0; });
+        }
+
+        // The stage starts with the next wait()
+        void add(stage s)
+        {
+            s.handle_.promise().owner = this;
+            stages_.push_back(std::move(s));
+        }
+
+        // Start the stages added since the last wait() on the pool and block until every stage is
+        // done, rethrows the first exception thrown by a stage
+        void wait()
+        {
+            {
+                std::lock_guard lock(mutex_);
+                running_ += stages_.size() - started_;
+            }
+            for(; started_ < stages_.size(); ++started_)
+                pool_.post(stages_[started_].handle_);
+
+            std::unique_lock lock(mutex_);
+            done_.wait(lock, [this]{ return running_ == 0; });
+            if(error_)
+                std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+
+    private:
+        friend class stage;
+
+        void stage_done(std::exception_ptr error)
+        {
+            // Notify under the lock, the pipeline may be destroyed as soon as it is released
+            std::lock_guard lock(mutex_);
+            if(error and !error_)
+                error_ = error;
+            --running_;
+            done_.notify_all();
+        }
+
+        thread_pool& pool_;
+        std::vector<stage> stages_;
+        std::size_t started_ = 0;
+        std::mutex mutex_;
+        std::condition_variable done_;
+        std::size_t running_ = 0;
+        std::exception_ptr error_;
+    };
+
+    inline void stage::promise_type::final_awaiter::await_suspend(std::coroutine_handle<promise_type> h) noexcept
+    {
+        h.promise().owner->stage_done(h.promise().error);
+    }
+
+
+    /*
+     * Column batches and the usual stages
+     */
+    template<typename... Ts>
+    using column_batch = std::tuple<std::vector<Ts>...>;
+
+    // Copy of the rows [begin, end) of a tuple of vectors
+    template<typename... Ts>
+    column_batch<Ts...> slice_rows(const std::tuple<std::vector<Ts>...>& tv, std::size_t begin, std::size_t end)
+    {
+        return std::apply([&](const auto&... columns)
+                          {
+                              return column_batch<Ts...>(std::vector<Ts>(columns.begin() + static_cast<std::ptrdiff_t>(begin),
+                                                                         columns.begin() + static_cast<std::ptrdiff_t>(end))...);
+                          }, tv);
+    }
+
+    template<typename... Ts>
+    void append_rows(std::tuple<std::vector<Ts>...>& tv, column_batch<Ts...>&& batch)
+    {
+        std::apply([&](auto&... to)
+                   {
+                       std::apply([&](auto&... from){ (to.insert(to.end(), std::make_move_iterator(from.begin()),
+                                                                 std::make_move_iterator(from.end())), ...); }, batch);
+                   }, tv);
+    }
+
+    namespace detail
+    {
+        // How a stage leaves a channel. A stage that drained its input or sent all its output
+        // calls done() : it leaves as a producer and doesn't close an input other stages may
+        // still read. Otherwise (exception, or nobody receiving its output any more) the channel
+        // is closed so that the other stages stop instead of waiting forever
+        template<typename Channel>
+        class leave_on_exit
+        {
+        public:
+            leave_on_exit(Channel& c, bool producer)
+                : channel_(c), producer_(producer)
+            {}
+
+            leave_on_exit(const leave_on_exit&) = delete;
+            leave_on_exit& operator=(const leave_on_exit&) = delete;
+
+            ~leave_on_exit()
+            {
+                if(!done_)
+                    channel_.close();
+                else if(producer_)
+                    channel_.producer_done();
+            }
+
+            void done()
+            {
+                done_ = true;
+            }
+
+        private:
+            Channel& channel_;
+            const bool producer_;
+            bool done_ = false;
+        };
+
+        template<typename... Ts>
+        stage send_batches(const std::tuple<std::vector<Ts>...>& tv, std::size_t batch_size,
+                           channel<column_batch<Ts...>>& out)
+        {
+            leave_on_exit output(out, true);
+            const std::size_t rows = std::get<0>(tv).size();
+            for(std::size_t begin = 0; begin < rows; begin += batch_size)
+                if(!co_await out.send(slice_rows(tv, begin, std::min(rows, begin + batch_size))))
+                    co_return;
+            output.done();
+        }
+
+        template<typename Batch, typename Generator>
+        stage generate_batches(Generator generate, channel<Batch>& out)
+        {
+            leave_on_exit output(out, true);
+            while(std::optional<Batch> batch = generate())
+                if(!co_await out.send(std::move(*batch)))
+                    co_return;
+            output.done();
+        }
+
+        template<typename In, typename Out, typename F>
+        stage transform_batches(channel<In>& in, channel<Out>& out, F f)
+        {
+            leave_on_exit input(in, false);
+            leave_on_exit output(out, true);
+            while(std::optional<In> batch = co_await in.receive())
+            {
+                Out result = f(std::move(*batch));
+                if(std::get<0>(result).empty())
+                    continue;
+                if(!co_await out.send(std::move(result)))
+                    co_return;
+            }
+            input.done();
+            output.done();
+        }
+    }
+
+    // Source : send tv in batches of batch_size rows
+    template<typename... Ts>
+    stage send_batches(const std::tuple<std::vector<Ts>...>& tv, std::size_t batch_size,
+                       channel<column_batch<Ts...>>& out)
+    {
+        out.add_producer();
+        return detail::send_batches(tv, batch_size, out);
+    }
+
+    // Source : send the batches returned by generate() until it returns an empty optional
+    template<typename Batch, typename Generator>
+    stage generate_batches(Generator generate, channel<Batch>& out)
+    {
+        out.add_producer();
+        return detail::generate_batches(std::move(generate), out);
+    }
+
+    // Send f(batch) for every batch received, empty results aren't forwarded
+    template<typename In, typename Out, typename F>
+    stage transform_batches(channel<In>& in, channel<Out>& out, F f)
+    {
+        out.add_producer();
+        return detail::transform_batches(in, out, std::move(f));
+    }
+
+    // Sink : call f(batch) for every batch received
+    template<typename Batch, typename F>
+    stage consume_batches(channel<Batch>& in, F f)
+    {
+        detail::leave_on_exit input(in, false);
+        while(std::optional<Batch> batch = co_await in.receive())
+            f(std::move(*batch));
+        input.done();
+    }
+
+    // Sink : append every batch received to tv
+    template<typename... Ts>
+    stage receive_batches(channel<column_batch<Ts...>>& in, std::tuple<std::vector<Ts>...>& tv)
+    {
+        detail::leave_on_exit input(in, false);
+        while(std::optional<column_batch<Ts...>> batch = co_await in.receive())
+            append_rows(tv, std::move(*batch));
+        input.done();
+    }
+}
+#endif //PIPELINE_CPP20_HPP
@@ -0,0 +1,253 @@
+#ifndef READ_COLUMNS_CPP17_HPP
+#define READ_COLUMNS_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include "parallel-cpp17.hpp"
+#include "parse-pow-of-0-5-cpp17.hpp"
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace test
+{
+    /*
+     * Streaming ingestion of delimited text (CSV like) straight into the tuple of vectors layout
+     * used by vectorize :
+     *   auto tv = test::read_columns<int, double, std::string>("data.csv");
+     * The input is read in large chunks by a background task while the previous chunk is parsed,
+     * each chunk is cut at line boundaries and its parts are parsed in parallel with
+     * std::from_chars, then appended in order to the columns.
+     * Delimiters are searched with memchr, which the C library implements with vector
+     * instructions.
+     * With validate_pow_of_0_5, floating point fields must follow the grammar of the _sf/_sd/_sld
+     * literals and be positive powers of 0.5 (see parse_pow_of_0_5).
+     */
+    struct read_options
+    {
+        char delimiter = ',';
+        // Skip the first line
+        bool header = false;
+        bool validate_pow_of_0_5 = false;
+        // 0 means as many as the hardware offers
+        unsigned threads = 0;
+        // Bytes read at once
+        std::size_t chunk_size = 1 << 22;
+    };
+
+    namespace detail
+    {
+        [[noreturn]] inline void parse_error(const std::string& what, std::size_t offset)
+        {
+            throw std::runtime_error("read_columns : " + what + " at byte " + std::to_string(offset));
+        }
+
+        template<typename T>
+        void parse_field(std::string_view field, std::vector<T>& column, const read_options& options,
+                         std::size_t offset)
+        {
+            if constexpr(std::is_same_v<T, std::string>)
+                column.emplace_back(field);
+            else if constexpr(std::is_floating_point_v<T>)
+            {
+                if(options.validate_pow_of_0_5)
+                {
+                    const auto value = parse_pow_of_0_5<T>(field);
+                    if(!value)
+                        parse_error("\"" + std::string(field) + "\" isn't a positive power of 0.5", offset);
+                    column.push_back(*value);
+                    return;
+                }
+                T value{};
+                const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+                if(error != std::errc{} or end != field.data() + field.size())
+                    parse_error("invalid number \"" + std::string(field) + "\"", offset);
+                column.push_back(value);
+            }
+            else
+            {
+                static_assert(std::is_integral_v<T>, "read_columns supports arithmetic types and std::string");
+                T value{};
+                const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+                if(error != std::errc{} or end != field.data() + field.size())
+                    parse_error("invalid number \"" + std::string(field) + "\"", offset);
+                column.push_back(value);
+            }
+        }
+
+        // Parse every line of [begin, end), offset is the position of begin in the input
+        template<typename... Ts, std::size_t... I>
+        void parse_lines(const char* begin, const char* end, std::tuple<std::vector<Ts>...>& columns,
+                         const read_options& options, std::size_t offset, std::index_sequence<I...>)
+        {
+            const char* const start = begin;
+            while(begin < end)
+            {
+                const char* eol = static_cast<const char*>(std::memchr(begin, '\n', static_cast<std::size_t>(end - begin)));
+                const char* next = eol ? eol + 1 : end;
+                const char* line_end = eol ? eol : end;
+                if(line_end != begin and line_end[-1] == '\r')
+                    --line_end;
+
+                if(line_end != begin)
+                {
+                    const std::size_t line_offset = offset + static_cast<std::size_t>(begin - start);
+                    const char* field = begin;
+                    auto next_field = [&]
+                    {
+                        const char* d = static_cast<const char*>(std::memchr(field, options.delimiter,
+                                                                             static_cast<std::size_t>(line_end - field)));
+                        const char* field_end = d ? d : line_end;
+                        std::string_view result(field, static_cast<std::size_t>(field_end - field));
+                        field = d ? d + 1 : line_end + 1;
+                        return result;
+                    };
+                    // Fields are read in column order thanks to the fold over the comma operator
+                    ((field <= line_end ? parse_field(next_field(), std::get<I>(columns), options, line_offset)
+                                        : parse_error("missing field", line_offset)), ...);
+                    if(field <= line_end)
+                        parse_error("too many fields", line_offset);
+                }
+                begin = next;
+            }
+        }
+
+        template<typename... Ts>
+        void append_columns(std::tuple<std::vector<Ts>...>& to, std::tuple<std::vector<Ts>...>&& from)
+        {
+            std::apply([&](auto&... dst)
+                       {
+                           std::apply([&](auto&... src)
+                                      {
+                                          (dst.insert(dst.end(), std::make_move_iterator(src.begin()),
+                                                      std::make_move_iterator(src.end())), ...);
+                                      }, from);
+                       }, to);
+        }
+
+        // Read up to size bytes, less only at the end of the input
+        inline std::string read_block(int fd, std::size_t size)
+        {
+            std::string block(size, '\0');
+            std::size_t done = 0;
+            while(done < size)
+            {
+                const ssize_t n = ::read(fd, &block[done], size - done);
+                if(n < 0 and errno == EINTR)
+                    continue;
+                if(n < 0)
+                    throw std::system_error(errno, std::generic_category(), "read_columns");
+                if(n == 0)
+                    break;
+                done += static_cast<std::size_t>(n);
+            }
+            block.resize(done);
+            return block;
+        }
+
+        // Parse complete lines of data in parallel and append them to columns
+        template<typename... Ts>
+        void parse_chunk(std::string_view data, std::tuple<std::vector<Ts>...>& columns,
+                         const read_options& options, std::size_t offset)
+        {
+            const unsigned count = thread_count(data.size(), options.threads);
+            std::vector<std::tuple<std::vector<Ts>...>> parts(count);
+            std::vector<std::exception_ptr> errors(count);
+
+            // Move the split points to the start of the next line
+            auto line_start = [&data](std::size_t pos)
+            {
+                if(pos == 0 or pos >= data.size())
+                    return std::min(pos, data.size());
+                const std::size_t eol = data.find('\n', pos - 1);
+                return eol == std::string_view::npos ? data.size() : eol + 1;
+            };
+
+            parallel_for_chunks(data.size(), count, [&](unsigned id, std::size_t begin, std::size_t end)
+            {
+                try
+                {
+                    begin = line_start(begin);
+                    end = line_start(end);
+                    parse_lines(data.data() + begin, data.data() + end, parts[id], options, offset + begin,
+                                std::index_sequence_for<Ts...>{});
+                }
+                catch(...)
+                {
+                    errors[id] = std::current_exception();
+                }
+            });
+
+            for(auto& e : errors)
+                if(e)
+                    std::rethrow_exception(e);
+            for(auto& part : parts)
+                append_columns(columns, std::move(part));
+        }
+    }
+
+    // Read every line of a file descriptor until its end, the descriptor isn't closed
+    template<typename... Ts>
+    std::tuple<std::vector<Ts>...> read_columns(int fd, const read_options& options = {})
+    {
+        std::tuple<std::vector<Ts>...> columns;
+        std::string data;
+        std::size_t offset = 0;
+        bool skip_header = options.header;
+
+        auto pending = std::async(std::launch::async, detail::read_block, fd, options.chunk_size);
+        for(;;)
+        {
+            std::string block = pending.get();
+            const bool last = block.empty();
+            // Read the next chunk while this one is parsed
+            if(!last)
+                pending = std::async(std::launch::async, detail::read_block, fd, options.chunk_size);
+
+            data.append(block);
+            std::size_t complete = last ? data.size() : data.rfind('\n');
+            if(complete == std::string::npos)
+                continue;
+            if(!last)
+                ++complete;
+
+            std::size_t begin = 0;
+            if(skip_header)
+            {
+                const std::size_t eol = data.find('\n');
+                begin = eol == std::string::npos ? complete : eol + 1;
+                skip_header = false;
+            }
+
+            detail::parse_chunk(std::string_view(data).substr(begin, complete - begin), columns, options,
+                                offset + begin);
+            offset += complete;
+            data.erase(0, complete);
+            if(last)
+                return columns;
+        }
+    }
+
+    template<typename... Ts>
+    std::tuple<std::vector<Ts>...> read_columns(const std::string& path, const read_options& options = {})
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            throw std::system_error(errno, std::generic_category(), "read_columns " + path);
+
+        struct closer
+        {
+            int fd;
+            ~closer() { ::close(fd); }
+        } guard{fd};
+        return read_columns<Ts...>(fd, options);
+    }
+}
+#endif //READ_COLUMNS_CPP17_HPP
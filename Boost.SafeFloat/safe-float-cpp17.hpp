@@ -0,0 +1,433 @@
+#ifndef SAFE_FLOAT_CPP17_HPP
+#define SAFE_FLOAT_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include <algorithm>
+#include <cfenv>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+
+namespace test
+{
+    /*
+     * safe_float<T, Policy> : a floating point number whose arithmetic operations check, according
+     * to the policy, that they didn't overflow, underflow, round (inexact), divide by zero or
+     * produce a NaN.
+     * The checks are selected at compile time : with unchecked_policy every operator is the raw
+     * operation on T. Checks on scalars look at the values (error-free transformations for
+     * inexact results) and don't touch the floating point environment.
+     * The batch operations (checked_transform and friends) work on whole columns of raw T :
+     * they clear the floating point exception flags, run a plain loop over a block of elements
+     * and test the flags once per block, so the loop itself has no branch and vectorizes.
+     * The literals (_sf, _sd, _sld) convert to the matching safe_float.
+     */
+    namespace safe_float_checks
+    {
+        enum : unsigned
+        {
+            none = 0,
+            overflow = 1 << 0,
+            underflow = 1 << 1,
+            inexact = 1 << 2,
+            invalid = 1 << 3,       // NaN produced from non NaN operands
+            divbyzero = 1 << 4,     // Infinity from a finite number divided by 0
+            all = overflow | underflow | inexact | invalid | divbyzero
+        };
+    }
+
+    class safe_float_error : public std::range_error
+    {
+    public:
+        safe_float_error(unsigned failed, const std::string& what)
+            : std::range_error(what), failed_(failed)
+        {}
+
+        // The safe_float_checks that failed
+        unsigned failed() const
+        {
+            return failed_;
+        }
+
+    private:
+        unsigned failed_;
+    };
+
+    namespace detail
+    {
+        inline std::string describe_checks(unsigned failed)
+        {
+            std::string result;
+            const std::pair<unsigned, const char*> names[] = {{safe_float_checks::overflow, "overflow"},
+                                                              {safe_float_checks::underflow, "underflow"},
+                                                              {safe_float_checks::inexact, "inexact"},
+                                                              {safe_float_checks::invalid, "invalid"},
+                                                              {safe_float_checks::divbyzero, "divbyzero"}};
+            for(const auto& [check, name] : names)
+                if(failed & check)
+                    result += result.empty() ? name : std::string(", ") + name;
+            return result;
+        }
+    }
+
+    // Default error handler of the policies
+    struct throw_on_error
+    {
+        [[noreturn]] static void report(unsigned failed, const char* operation)
+        {
+            throw safe_float_error(failed, std::string(operation) + " : " + detail::describe_checks(failed));
+        }
+    };
+
+    template<unsigned CHECKS, typename OnError = throw_on_error>
+    struct check_policy
+    {
+        static constexpr unsigned checks = CHECKS;
+        using on_error = OnError;
+    };
+
+    using unchecked_policy = check_policy<safe_float_checks::none>;
+    // Inexact results are the rule rather than the exception, they are opt-in
+    using default_policy = check_policy<safe_float_checks::overflow | safe_float_checks::underflow
+                                        | safe_float_checks::invalid | safe_float_checks::divbyzero>;
+
+
+    namespace detail
+    {
+        template<typename T>
+        constexpr bool is_tiny(T r)
+        {
+            return r != 0 and r < std::numeric_limits<T>::min() and r > -std::numeric_limits<T>::min();
+        }
+
+        // Checks common to every operation : r = a op b
+        // is_inexact() is only called when the policy checks inexact results, or for tiny results
+        // as underflow means tiny and inexact, like FE_UNDERFLOW in the batch operations
+        // An infinity from finite operands is an overflow, unless b is 0 : only a division by 0
+        // gets there, which is FE_DIVBYZERO and not FE_OVERFLOW
+        template<typename Policy, typename T, typename InexactTest>
+        void check_result(T a, T b, T r, InexactTest&& is_inexact, const char* operation)
+        {
+            constexpr unsigned checks = Policy::checks;
+            unsigned failed = 0;
+            if constexpr(checks & safe_float_checks::overflow)
+                if(std::isinf(r) and std::isfinite(a) and std::isfinite(b) and b != 0)
+                    failed |= safe_float_checks::overflow;
+            if constexpr(checks & safe_float_checks::divbyzero)
+                if(std::isinf(r) and std::isfinite(a) and b == 0)
+                    failed |= safe_float_checks::divbyzero;
+            if constexpr(checks & safe_float_checks::underflow)
+                if((is_tiny(r) or r == 0) and is_inexact())
+                    failed |= safe_float_checks::underflow;
+            if constexpr(checks & safe_float_checks::invalid)
+                if(std::isnan(r) and !std::isnan(a) and !std::isnan(b))
+                    failed |= safe_float_checks::invalid;
+            if constexpr(checks & safe_float_checks::inexact)
+                if(is_inexact())
+                    failed |= safe_float_checks::inexact;
+            if(failed)
+                Policy::on_error::report(failed, operation);
+        }
+
+        // Error-free transformations : the result is inexact iff the rounding error isn't 0
+        // Sums are exact in the subnormal range, so the transformation holds for tiny results
+        template<typename T>
+        bool add_is_inexact(T a, T b, T r)
+        {
+            const T bb = r - a;
+            return std::isfinite(r) and (a - (r - bb)) + (b - bb) != 0;
+        }
+
+        // Is x * 2^e rounded in T (ldexp rounds when the result is subnormal) ?
+        template<typename T>
+        bool scale_is_inexact(T x, int e)
+        {
+            return std::ldexp(std::ldexp(x, e), -e) != x;
+        }
+
+        // For tiny or zero results the rounding error given by fma may itself round to 0, the
+        // operation is then redone on the mantissas, whose result is normal, and scaled back
+        template<typename T>
+        bool mul_is_inexact(T a, T b, T r)
+        {
+            if(!std::isfinite(r))
+                return false;
+            if(!is_tiny(r) and r != 0)
+                return std::fma(a, b, -r) != 0;
+            if(a == 0 or b == 0)
+                return false;
+            int ea = 0;
+            int eb = 0;
+            const T ma = std::frexp(a, &ea);
+            const T mb = std::frexp(b, &eb);
+            const T m = ma * mb;
+            return std::fma(ma, mb, -m) != 0 or scale_is_inexact(m, ea + eb);
+        }
+
+        // A finite number divided by an infinity is an exact 0
+        template<typename T>
+        bool div_is_inexact(T a, T b, T r)
+        {
+            if(!std::isfinite(r) or b == 0 or std::isinf(b))
+                return false;
+            if(!is_tiny(r) and r != 0)
+                return std::fma(r, b, -a) != 0;
+            if(a == 0)
+                return false;
+            int ea = 0;
+            int eb = 0;
+            const T ma = std::frexp(a, &ea);
+            const T mb = std::frexp(b, &eb);
+            const T q = ma / mb;
+            return std::fma(q, mb, -ma) != 0 or scale_is_inexact(q, ea - eb);
+        }
+    }
+
+
+    template<typename T, typename Policy = default_policy>
+    class safe_float
+    {
+        static_assert(std::is_floating_point_v<T>, "safe_float is for floating point types");
+
+    public:
+        using value_type = T;
+        using policy_type = Policy;
+
+        constexpr safe_float() = default;
+
+        // Implicit so that literals and raw values convert to it
+        constexpr safe_float(T value)
+            : value_(value)
+        {}
+
+        constexpr T value() const
+        {
+            return value_;
+        }
+
+        constexpr explicit operator T() const
+        {
+            return value_;
+        }
+
+        friend safe_float operator+(safe_float lhs, safe_float rhs)
+        {
+            const T r = lhs.value_ + rhs.value_;
+            if constexpr(Policy::checks != safe_float_checks::none)
+                detail::check_result<Policy>(lhs.value_, rhs.value_, r,
+                                             [&]{ return detail::add_is_inexact(lhs.value_, rhs.value_, r); },
+                                             "addition");
+            return r;
+        }
+
+        friend safe_float operator-(safe_float lhs, safe_float rhs)
+        {
+            const T r = lhs.value_ - rhs.value_;
+            if constexpr(Policy::checks != safe_float_checks::none)
+                detail::check_result<Policy>(lhs.value_, rhs.value_, r,
+                                             [&]{ return detail::add_is_inexact(lhs.value_, -rhs.value_, r); },
+                                             "subtraction");
+            return r;
+        }
+
+        friend safe_float operator*(safe_float lhs, safe_float rhs)
+        {
+            const T r = lhs.value_ * rhs.value_;
+            if constexpr(Policy::checks != safe_float_checks::none)
+                detail::check_result<Policy>(lhs.value_, rhs.value_, r,
+                                             [&]{ return detail::mul_is_inexact(lhs.value_, rhs.value_, r); },
+                                             "multiplication");
+            return r;
+        }
+
+        friend safe_float operator/(safe_float lhs, safe_float rhs)
+        {
+            const T r = lhs.value_ / rhs.value_;
+            if constexpr(Policy::checks != safe_float_checks::none)
+                detail::check_result<Policy>(lhs.value_, rhs.value_, r,
+                                             [&]{ return detail::div_is_inexact(lhs.value_, rhs.value_, r); },
+                                             "division");
+            return r;
+        }
+
+        safe_float& operator+=(safe_float other) { return *this = *this + other; }
+        safe_float& operator-=(safe_float other) { return *this = *this - other; }
+        safe_float& operator*=(safe_float other) { return *this = *this * other; }
+        safe_float& operator/=(safe_float other) { return *this = *this / other; }
+
+        constexpr safe_float operator-() const { return -value_; }
+        constexpr safe_float operator+() const { return *this; }
+
+        friend constexpr bool operator==(safe_float lhs, safe_float rhs) { return lhs.value_ == rhs.value_; }
+        friend constexpr bool operator!=(safe_float lhs, safe_float rhs) { return lhs.value_ != rhs.value_; }
+        friend constexpr bool operator<(safe_float lhs, safe_float rhs) { return lhs.value_ < rhs.value_; }
+        friend constexpr bool operator<=(safe_float lhs, safe_float rhs) { return lhs.value_ <= rhs.value_; }
+        friend constexpr bool operator>(safe_float lhs, safe_float rhs) { return lhs.value_ > rhs.value_; }
+        friend constexpr bool operator>=(safe_float lhs, safe_float rhs) { return lhs.value_ >= rhs.value_; }
+
+    private:
+        T value_ = 0;
+    };
+
+    // A safe_float with checks disabled is exactly a T
+    static_assert(sizeof(safe_float<double, unchecked_policy>) == sizeof(double), "No overhead");
+    static_assert(std::is_trivially_copyable_v<safe_float<double>>, "No overhead");
+
+    template<typename T, typename Policy>
+    std::ostream& operator<<(std::ostream& os, safe_float<T, Policy> f)
+    {
+        return os << f.value();
+    }
+
+
+    /*
+     * Batch operations over raw columns (std::vector<T> such as the ones returned by get_vector,
+     * or pointer and size)
+     */
+    namespace detail
+    {
+        // Elements between two tests of the exception flags
+        constexpr std::size_t safe_float_block = 1024;
+
+        constexpr int fe_mask(unsigned checks)
+        {
+            return ((checks & safe_float_checks::overflow) ? FE_OVERFLOW : 0)
+                 | ((checks & safe_float_checks::underflow) ? FE_UNDERFLOW : 0)
+                 | ((checks & safe_float_checks::inexact) ? FE_INEXACT : 0)
+                 | ((checks & safe_float_checks::invalid) ? FE_INVALID : 0)
+                 | ((checks & safe_float_checks::divbyzero) ? FE_DIVBYZERO : 0);
+        }
+
+        inline unsigned from_fe_flags(int flags)
+        {
+            return ((flags & FE_OVERFLOW) ? safe_float_checks::overflow : 0u)
+                 | ((flags & FE_UNDERFLOW) ? safe_float_checks::underflow : 0u)
+                 | ((flags & FE_INEXACT) ? safe_float_checks::inexact : 0u)
+                 | ((flags & FE_INVALID) ? safe_float_checks::invalid : 0u)
+                 | ((flags & FE_DIVBYZERO) ? safe_float_checks::divbyzero : 0u);
+        }
+
+        // Saves the exception flags of the caller and restores them on exit
+        class fe_flags_guard
+        {
+        public:
+            fe_flags_guard()
+            {
+                std::fegetexceptflag(&saved_, FE_ALL_EXCEPT);
+            }
+
+            ~fe_flags_guard()
+            {
+                std::fesetexceptflag(&saved_, FE_ALL_EXCEPT);
+            }
+
+        private:
+            std::fexcept_t saved_;
+        };
+
+        // Run kernel(begin, end) on blocks of [0, N) and test the flags after each of them
+        template<typename Policy, typename Kernel>
+        void checked_blocks(std::size_t N, const char* operation, Kernel&& kernel)
+        {
+            if constexpr(Policy::checks == safe_float_checks::none)
+                kernel(std::size_t{0}, N);
+            else
+            {
+                constexpr int mask = fe_mask(Policy::checks);
+                fe_flags_guard guard;
+                for(std::size_t begin = 0; begin < N; begin += safe_float_block)
+                {
+                    std::feclearexcept(FE_ALL_EXCEPT);
+                    kernel(begin, std::min(N, begin + safe_float_block));
+                    if(const int raised = std::fetestexcept(mask))
+                        Policy::on_error::report(from_fe_flags(raised), operation);
+                }
+            }
+        }
+    }
+
+    // out[i] = op(a[i], b[i]), out may alias a or b
+    template<typename Policy = default_policy, typename T, typename Op>
+    void checked_transform(const T* a, const T* b, T* out, std::size_t N, Op op, const char* operation = "transform")
+    {
+        detail::checked_blocks<Policy>(N, operation, [&](std::size_t begin, std::size_t end)
+        {
+            for(std::size_t i = begin; i < end; ++i)
+                out[i] = op(a[i], b[i]);
+        });
+    }
+
+    template<typename Policy = default_policy, typename T, typename Op>
+    void checked_transform(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& out, Op op,
+                           const char* operation = "transform")
+    {
+        if(a.size() != b.size())
+            throw std::invalid_argument("Columns of different sizes");
+        out.resize(a.size());
+        checked_transform<Policy>(a.data(), b.data(), out.data(), a.size(), op, operation);
+    }
+
+    template<typename Policy = default_policy, typename T>
+    void checked_add(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& out)
+    {
+        checked_transform<Policy>(a, b, out, [](T x, T y){ return x + y; }, "addition");
+    }
+
+    template<typename Policy = default_policy, typename T>
+    void checked_subtract(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& out)
+    {
+        checked_transform<Policy>(a, b, out, [](T x, T y){ return x - y; }, "subtraction");
+    }
+
+    template<typename Policy = default_policy, typename T>
+    void checked_multiply(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& out)
+    {
+        checked_transform<Policy>(a, b, out, [](T x, T y){ return x * y; }, "multiplication");
+    }
+
+    template<typename Policy = default_policy, typename T>
+    void checked_divide(const std::vector<T>& a, const std::vector<T>& b, std::vector<T>& out)
+    {
+        checked_transform<Policy>(a, b, out, [](T x, T y){ return x / y; }, "division");
+    }
+
+    // Multiply every element of a column by a factor in place
+    template<typename Policy = default_policy, typename T>
+    void checked_scale(std::vector<T>& column, T factor)
+    {
+        T* data = column.data();
+        detail::checked_blocks<Policy>(column.size(), "multiplication", [&](std::size_t begin, std::size_t end)
+        {
+            for(std::size_t i = begin; i < end; ++i)
+                data[i] *= factor;
+        });
+    }
+
+    // Sum of a column, with several accumulators so the additions don't form a single chain
+    template<typename Policy = default_policy, typename T>
+    safe_float<T, Policy> checked_sum(const std::vector<T>& column)
+    {
+        constexpr std::size_t lanes = 8;
+        T partial[lanes] = {};
+        const T* data = column.data();
+        detail::checked_blocks<Policy>(column.size(), "sum", [&](std::size_t begin, std::size_t end)
+        {
+            std::size_t i = begin;
+            for(; i + lanes <= end; i += lanes)
+                for(std::size_t j = 0; j < lanes; ++j)
+                    partial[j] += data[i + j];
+            for(; i < end; ++i)
+                partial[0] += data[i];
+        });
+
+        safe_float<T, Policy> result = partial[0];
+        for(std::size_t j = 1; j < lanes; ++j)
+            result += partial[j];
+        return result;
+    }
+}
+#endif //SAFE_FLOAT_CPP17_HPP
@@ -0,0 +1,390 @@
+#ifndef SHARED_COLUMNS_CPP17_HPP
+#define SHARED_COLUMNS_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace test
+{
+    /*
+     * Tuple of vectors living in a named POSIX shared memory segment, so that one writer process
+     * and many reader processes share the same columns without copying them.
+     * The segment starts with a header (see detail::shared_header) followed by one array per
+     * column, located by offsets from the start of the segment and not by pointers, as each
+     * process maps the segment at its own address.
+     * Rows are published by the writer with a release store of the row count : once a reader saw
+     * the count, the rows below it are readable. In-place updates of published rows are made
+     * inside a seqlock so that readers going through read() get a consistent view.
+     * Columns must be trivially copyable and the capacity (in rows) is fixed at creation.
+     */
+    template<typename T>
+    class column_span
+    {
+    public:
+        column_span(T* data, std::size_t size)
+            : data_(data), size_(size)
+        {}
+
+        T* data() const { return data_; }
+        std::size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        T* begin() const { return data_; }
+        T* end() const { return data_ + size_; }
+        T& operator[](std::size_t i) const { return data_[i]; }
+
+    private:
+        T* data_;
+        std::size_t size_;
+    };
+
+
+    namespace detail
+    {
+        constexpr std::uint64_t shared_magic = 0x534146454c4f4154ull;
+        constexpr std::size_t shared_alignment = 64;
+
+        // Position of T in Ts..., T must appear exactly once
+        template<typename T, typename... Ts>
+        constexpr std::size_t index_of()
+        {
+            constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+            std::size_t count = 0, result = 0;
+            for(std::size_t i = 0; i < sizeof...(Ts); ++i)
+                if(matches[i])
+                {
+                    result = i;
+                    ++count;
+                }
+            return count == 1 ? result : sizeof...(Ts);
+        }
+
+        template<typename T, typename... Ts>
+        constexpr std::size_t checked_index_of()
+        {
+            static_assert(index_of<T, Ts...>() < sizeof...(Ts), "Type not in columns or duplicated");
+            return index_of<T, Ts...>();
+        }
+
+        constexpr std::size_t align_up(std::size_t n)
+        {
+            return (n + shared_alignment - 1) / shared_alignment * shared_alignment;
+        }
+
+        // The atomics are used by several processes, they need to be address-free
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared atomics need to be lock free");
+
+        template<std::size_t COLUMNS>
+        struct shared_header
+        {
+            // Published last, see create and attach
+            std::atomic<std::uint64_t> magic;
+            std::uint64_t capacity;
+            std::uint64_t element_sizes[COLUMNS];
+            std::uint64_t offsets[COLUMNS];
+            // Even when stable, odd while the writer updates published rows in place
+            alignas(shared_alignment) std::atomic<std::uint64_t> sequence;
+            // Number of published rows
+            alignas(shared_alignment) std::atomic<std::uint64_t> rows;
+        };
+
+        // RAII owner of a mapping of a shared memory segment
+        class shared_mapping
+        {
+        public:
+            shared_mapping() = default;
+
+            shared_mapping(const std::string& name, bool create, std::size_t size)
+                : name_(name), owner_(create)
+            {
+                const int fd = create ? ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)
+                                      : ::shm_open(name.c_str(), O_RDONLY, 0);
+                if(fd < 0)
+                    throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+
+                if(create and ::ftruncate(fd, static_cast<off_t>(size)) != 0)
+                {
+                    const int error = errno;
+                    ::close(fd);
+                    ::shm_unlink(name.c_str());
+                    throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+                }
+                if(!create)
+                {
+                    struct stat st;
+                    if(::fstat(fd, &st) != 0)
+                    {
+                        const int error = errno;
+                        ::close(fd);
+                        throw std::system_error(error, std::generic_category(), "fstat " + name);
+                    }
+                    size = static_cast<std::size_t>(st.st_size);
+                }
+
+                void* address = ::mmap(nullptr, size, create ? PROT_READ | PROT_WRITE : PROT_READ,
+                                       MAP_SHARED, fd, 0);
+                const int error = errno;
+                ::close(fd);
+                if(address == MAP_FAILED)
+                {
+                    if(create)
+                        ::shm_unlink(name.c_str());
+                    throw std::system_error(error, std::generic_category(), "mmap " + name);
+                }
+                address_ = static_cast<unsigned char*>(address);
+                size_ = size;
+            }
+
+            shared_mapping(shared_mapping&& other) noexcept
+            {
+                swap(other);
+            }
+
+            shared_mapping& operator=(shared_mapping&& other) noexcept
+            {
+                shared_mapping(std::move(other)).swap(*this);
+                return *this;
+            }
+
+            // The creator removes the name, processes that already mapped the segment keep it
+            ~shared_mapping()
+            {
+                if(address_)
+                    ::munmap(address_, size_);
+                if(owner_)
+                    ::shm_unlink(name_.c_str());
+            }
+
+            void swap(shared_mapping& other) noexcept
+            {
+                std::swap(name_, other.name_);
+                std::swap(owner_, other.owner_);
+                std::swap(address_, other.address_);
+                std::swap(size_, other.size_);
+            }
+
+            unsigned char* address() const { return address_; }
+            std::size_t size() const { return size_; }
+
+        private:
+            std::string name_;
+            bool owner_ = false;
+            unsigned char* address_ = nullptr;
+            std::size_t size_ = 0;
+        };
+    }
+
+
+    template<typename... Ts>
+    class shared_columns
+    {
+        static_assert((std::is_trivially_copyable_v<Ts> and ...), "Shared columns must be trivially copyable");
+
+    public:
+        using header_type = detail::shared_header<sizeof...(Ts)>;
+
+        // Create a new segment (fails if the name already exists) able to hold capacity rows
+        static shared_columns create(const std::string& name, std::size_t capacity)
+        {
+            const std::size_t sizes[] = {sizeof(Ts)...};
+            std::size_t total = detail::align_up(sizeof(header_type));
+            std::uint64_t offsets[sizeof...(Ts)];
+            for(std::size_t i = 0; i < sizeof...(Ts); ++i)
+            {
+                offsets[i] = total;
+                total += detail::align_up(sizes[i] * capacity);
+            }
+
+            shared_columns result(detail::shared_mapping(name, true, total), false);
+            header_type* h = new (result.mapping_.address()) header_type;
+            h->capacity = capacity;
+            for(std::size_t i = 0; i < sizeof...(Ts); ++i)
+            {
+                h->element_sizes[i] = sizes[i];
+                h->offsets[i] = offsets[i];
+            }
+            h->sequence.store(0, std::memory_order_relaxed);
+            h->rows.store(0, std::memory_order_relaxed);
+            // Written last so that a reader attaching too early sees an invalid segment
+            h->magic.store(detail::shared_magic, std::memory_order_release);
+            return result;
+        }
+
+        // Attach read-only to a segment created by another process with the same column types
+        static shared_columns attach(const std::string& name)
+        {
+            shared_columns result(detail::shared_mapping(name, false, 0), true);
+            if(result.mapping_.size() < sizeof(header_type))
+                throw std::runtime_error("Shared segment " + name + " is too small");
+
+            const header_type* h = result.header();
+            const std::uint64_t sizes[] = {sizeof(Ts)...};
+            // Acquire : the other fields of the header are read after the magic
+            bool valid = h->magic.load(std::memory_order_acquire) == detail::shared_magic;
+            for(std::size_t i = 0; valid and i < sizeof...(Ts); ++i)
+                valid = h->element_sizes[i] == sizes[i]
+                        and h->offsets[i] + sizes[i] * h->capacity <= result.mapping_.size();
+            if(!valid)
+                throw std::runtime_error("Shared segment " + name + " doesn't hold these columns");
+            return result;
+        }
+
+        bool read_only() const
+        {
+            return read_only_;
+        }
+
+        std::size_t capacity() const
+        {
+            return header()->capacity;
+        }
+
+        // Number of published rows
+        std::size_t size() const
+        {
+            return header()->rows.load(std::memory_order_acquire);
+        }
+
+        // Append rows from the layout created by vectorize and publish them at once
+        // Returns false without copying anything if they don't fit
+        bool append(const std::tuple<std::vector<Ts>...>& tv)
+        {
+            check_writable();
+            const std::size_t rows = header()->rows.load(std::memory_order_relaxed);
+            const std::size_t count = std::get<0>(tv).size();
+            bool fits = true;
+            std::apply([&](const auto&... columns){ fits = ((columns.size() == count) and ...); }, tv);
+            if(!fits or rows + count > capacity())
+                return false;
+
+            copy_rows(tv, rows, std::index_sequence_for<Ts...>{});
+            header()->rows.store(rows + count, std::memory_order_release);
+            return true;
+        }
+
+        bool push_back(const Ts&... values)
+        {
+            check_writable();
+            const std::size_t row = header()->rows.load(std::memory_order_relaxed);
+            if(row >= capacity())
+                return false;
+            set_row(row, std::forward_as_tuple(values...), std::index_sequence_for<Ts...>{});
+            header()->rows.store(row + 1, std::memory_order_release);
+            return true;
+        }
+
+        // In-place update of an already published row, readers see it atomically through read()
+        // Returns false without writing anything if row isn't published
+        bool update(std::size_t row, const Ts&... values)
+        {
+            check_writable();
+            if(row >= header()->rows.load(std::memory_order_relaxed))
+                return false;
+            auto& sequence = header()->sequence;
+            const std::uint64_t s = sequence.load(std::memory_order_relaxed);
+            sequence.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            set_row(row, std::forward_as_tuple(values...), std::index_sequence_for<Ts...>{});
+            sequence.store(s + 2, std::memory_order_release);
+            return true;
+        }
+
+        // Call f(size) until no in-place update happened while it ran, f reads the published
+        // rows through the spans and must copy out what it needs (it may see torn values
+        // in a run that gets retried)
+        template<typename F>
+        auto read(F&& f) const
+        {
+            const auto& sequence = header()->sequence;
+            for(;;)
+            {
+                const std::uint64_t before = sequence.load(std::memory_order_acquire);
+                if(before & 0x1)
+                    continue;
+                auto result = f(size());
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(sequence.load(std::memory_order_relaxed) == before)
+                    return result;
+            }
+        }
+
+        // Zero copy access to the published rows of the column of type T
+        template<typename T>
+        column_span<const T> span() const
+        {
+            return column_span<const T>(column<T>(), size());
+        }
+
+        // Writable access for the writer, covers the whole capacity
+        template<typename T>
+        column_span<T> writable_span()
+        {
+            check_writable();
+            return column_span<T>(column<T>(), capacity());
+        }
+
+    private:
+        shared_columns(detail::shared_mapping mapping, bool read_only)
+            : mapping_(std::move(mapping)), read_only_(read_only)
+        {}
+
+        void check_writable() const
+        {
+            if(read_only_)
+                throw std::logic_error("Shared columns attached read-only");
+        }
+
+        header_type* header() const
+        {
+            return reinterpret_cast<header_type*>(mapping_.address());
+        }
+
+        template<std::size_t I>
+        auto column_at() const
+        {
+            using T = std::tuple_element_t<I, std::tuple<Ts...>>;
+            return reinterpret_cast<T*>(mapping_.address() + header()->offsets[I]);
+        }
+
+        template<typename T>
+        T* column() const
+        {
+            return column_at<detail::checked_index_of<T, Ts...>()>();
+        }
+
+        template<std::size_t... I>
+        void copy_rows(const std::tuple<std::vector<Ts>...>& tv, std::size_t first, std::index_sequence<I...>)
+        {
+            (std::copy(std::get<I>(tv).begin(), std::get<I>(tv).end(), column_at<I>() + first), ...);
+        }
+
+        template<typename Row, std::size_t... I>
+        void set_row(std::size_t row, const Row& values, std::index_sequence<I...>)
+        {
+            ((column_at<I>()[row] = std::get<I>(values)), ...);
+        }
+
+        detail::shared_mapping mapping_;
+        bool read_only_;
+    };
+
+    // get_vector-like access to the published rows of a column
+    template<typename T, typename... Ts>
+    column_span<const T> get_span(const shared_columns<Ts...>& columns)
+    {
+        return columns.template span<T>();
+    }
+}
+#endif //SHARED_COLUMNS_CPP17_HPP
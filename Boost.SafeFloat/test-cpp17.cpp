@@ -1,6 +1,21 @@
 #include "test-cpp17.hpp"
 #include "competency-test-cpp17.hpp"
+#include "column-index-cpp17.hpp"
+#include "filter-cpp17.hpp"
+#include "group-by-cpp17.hpp"
+#include "column-encoding-cpp17.hpp"
+#include "shared-columns-cpp17.hpp"
+#include "versioned-columns-cpp17.hpp"
+#include "dynamic-table-cpp17.hpp"
+#include "safe-float-cpp17.hpp"
+#include "read-columns-cpp17.hpp"
+#include "column-aggregates-cpp17.hpp"
+#include "generate-cpp17.hpp"
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <numeric>
+#include <sys/wait.h>
 
 // Print vector
 template<typename T>
@@ -57,8 +72,6 @@ void test_floating_literal()
     static_assert(0.5_sf == 0.5f, "Problem");
     static_assert(0.25_sf == 0.25f, "Problem");
     static_assert(.03125_sd == .03125, "Problem");
-    static_assert(1_sf == 1.f, "Problem");
-    static_assert(2_sf == 2.f, "Problem");
     static_assert(62.5e-3_sld == 62.5e-3l, "Problem");
     static_assert(9.5367431640625e-07_sd == 9.5367431640625e-07, "Problem");
     static_assert(125.e-3_sf == 125.e-3f, "Problem");
@@ -66,9 +79,13 @@ void test_floating_literal()
     static_assert(0x1p-1_sf == 0x1p-1f, "Problem");
     static_assert(0x8.0p-98_sd == 0x8.0p-98, "Problem");
     static_assert(0x.00004p+3_sld == 0x.00004p+3l, "Problem");
+    static_assert(0x1p-149_sf == 0x1p-149f, "Problem");
+    static_assert(0x1p-1074_sd == 0x1p-1074, "Problem");
     
     
     // Shouldn't compile
+    //1_sf;
+    //2_sf;
     //3_sf;
     //0.26_sd;
     //9.5367431640626e-07_sd;
@@ -76,6 +93,7 @@ void test_floating_literal()
     //0x3.0p-7_sf;
     //0_sf;
     //0x0p0_sd;
+    //0x1p-150_sf;
     
     // This one should be a parse error
     //0x4_sf;
@@ -116,3 +134,476 @@ void test_get_vector()
     // Overload for const tuple
     std::cout << test::get_vector<double>(tv2).front() << std::endl;
 }
+
+
+void test_column_index()
+{
+    std::tuple<int, const char*, double, Point> t(48, "foo", 3.14, {15.2, 48.6});
+    auto tv = test::vectorize(100000, t);
+    auto& ids = test::get_vector<int>(tv);
+    for(std::size_t i = 0; i < ids.size(); ++i)
+        ids[i] = static_cast<int>(i % 50000);
+
+    // Parallel bulk build
+    auto index = test::make_column_index<int>(tv);
+    std::cout << "Rows with id 42 : " << index.find_all(42).size() << std::endl;
+
+    // Incremental maintenance on append
+    ids.push_back(-1);
+    test::get_vector<const char*>(tv).push_back("bar");
+    test::get_vector<double>(tv).push_back(2.71);
+    test::get_vector<Point>(tv).push_back({1.0, 2.0});
+    index.update();
+
+    if(auto row = index.lookup(tv, -1))
+    {
+        std::get<double&>(*row) = 1.41;
+        std::cout << "Row with id -1 : " << *row << std::endl;
+    }
+    std::cout << "Row with id 50000 found : " << std::boolalpha << index.find(50000).has_value() << std::endl;
+
+    // A single value repeated on every row, as vectorize creates, is built in linear time
+    auto same = test::vectorize(1 << 20, std::make_tuple(7));
+    auto same_index = test::make_column_index<int>(same);
+    std::cout << "Rows with id 7 : " << same_index.find_all(7).size() << std::endl;
+}
+
+
+void test_filter()
+{
+    std::tuple<int, const char*, double, Point> t(48, "foo", 3.14, {15.2, 48.6});
+    auto tv = test::vectorize(200, t);
+    auto& ints = test::get_vector<int>(tv);
+    auto& doubles = test::get_vector<double>(tv);
+    for(std::size_t i = 0; i < ints.size(); ++i)
+    {
+        ints[i] = static_cast<int>(i);
+        doubles[i] = i % 3 == 0 ? 1.0 : 2.0;
+    }
+
+    using test::column;
+    auto result = test::filter(tv, column<int>() < 10 && column<double>() == 1.0);
+    std::cout << "Filtered : " << result << std::endl;
+
+    auto other = test::filter(tv, 195 <= column<int>() || !(column<int>() > 2));
+    std::cout << "Filtered : " << test::get_vector<int>(other) << std::endl;
+
+    // Lazy view, modifying the original rows
+    for(auto row : test::select_view(tv, column<int>() >= 198))
+        std::get<double&>(row) = -1.0;
+    std::cout << "Last rows : " << test::get_row(tv, 197) << ", "
+              << test::get_row(tv, 198) << ", " << test::get_row(tv, 199) << std::endl;
+
+    // Columns of different sizes, as get_vector allows to make, are rejected
+    auto uneven = test::vectorize(100, std::make_tuple(0, 1.0));
+    test::get_vector<int>(uneven).resize(140);
+    try
+    {
+        test::filter(uneven, column<int>() < 10 && column<double>() == 1.0);
+    }
+    catch(const std::invalid_argument& e)
+    {
+        std::cout << "Uneven columns : " << e.what() << std::endl;
+    }
+}
+
+
+void test_group_by()
+{
+    std::tuple<int, double, float> t(0, 1.5, 2.f);
+    auto tv = test::vectorize(10, t);
+    auto& keys = test::get_vector<int>(tv);
+    auto& floats = test::get_vector<float>(tv);
+    for(std::size_t i = 0; i < keys.size(); ++i)
+    {
+        keys[i] = static_cast<int>(i / 4);
+        floats[i] = static_cast<float>(i);
+    }
+
+    // Keys are sorted : groups come in key order
+    auto sorted = test::group_by<int>(tv).presorted()
+                      .aggregate(test::sum<double>(), test::min<float>(), test::max<float>(), test::count());
+    std::cout << "Sorted group by : " << sorted << std::endl;
+
+    // Hash aggregation only gives the same groups
+    auto hashed = test::group_by<int>(tv)
+                      .aggregate(test::sum<double>(), test::min<float>(), test::max<float>(), test::count());
+    std::cout << "Group count : " << test::get_vector<int>(hashed).size() << std::endl;
+
+    // Enough rows for several threads, their partial tables are merged
+    auto big = test::vectorize(1 << 17, std::make_tuple(0, 1.0));
+    auto& big_keys = test::get_vector<int>(big);
+    for(std::size_t i = 0; i < big_keys.size(); ++i)
+        big_keys[i] = static_cast<int>(i % 100);
+    auto merged = test::group_by<int>(big).threads(4).aggregate(test::sum<double>(), test::count());
+    const auto& sums = std::get<1>(merged);
+    const auto& counts = std::get<2>(merged);
+    std::cout << "Merged groups : " << test::get_vector<int>(merged).size()
+              << ", rows " << std::accumulate(counts.begin(), counts.end(), std::size_t{0})
+              << ", sum " << std::accumulate(sums.begin(), sums.end(), 0.) << std::endl;
+
+    // An aggregated column shorter than the key column is rejected
+    test::get_vector<int>(tv).push_back(87);
+    try
+    {
+        test::group_by<int>(tv).aggregate(test::sum<double>());
+    }
+    catch(const std::invalid_argument& e)
+    {
+        std::cout << "Uneven columns : " << e.what() << std::endl;
+    }
+}
+
+
+void test_column_encoding()
+{
+    std::tuple<int, const char*, double> t(48, "foo", 3.14);
+
+    // Every column is a single run
+    auto rle = test::vectorize_rle(1000, t);
+    auto& ints = std::get<0>(rle);
+    ints.set(10, 12);
+    ints.set(11, 48);
+    ints.compact();
+    std::cout << "Runs : " << ints.runs() << ", sum : " << ints.sum<long>()
+              << ", rows < 48 : " << ints.select(std::less<>{}, 48).indices() << std::endl;
+
+    auto tv = test::vectorize(1000, t);
+    auto& names = test::get_vector<const char*>(tv);
+    for(std::size_t i = 0; i < names.size(); ++i)
+        names[i] = i % 3 == 0 ? "foo" : i % 3 == 1 ? "bar" : "baz";
+    test::dictionary_column<const char*> dict(names);
+    std::string bar = "bar";
+    dict.set(1, "foo");
+    dict.compact();
+    std::cout << "Dictionary : " << dict.dictionary() << ", \"bar\" count : " << dict.count(bar.c_str())
+              << ", \"foo\" rows : " << dict.select(std::equal_to<>{}, "foo").count() << std::endl;
+
+    // Increasing ids fit in one byte per row
+    std::vector<int> ids(1000);
+    for(std::size_t i = 0; i < ids.size(); ++i)
+        ids[i] = static_cast<int>(100000 + 3 * i);
+    test::frame_of_reference_column<int> frame(ids);
+    frame.push_back(-5);
+    std::cout << "Frame of reference : " << frame.encoded_bytes() << " bytes instead of "
+              << (ids.size() + 1) * sizeof(int) << ", sum : " << frame.sum<long>()
+              << ", min : " << frame.min() << ", max : " << frame.max()
+              << ", rows >= 102994 : " << frame.select(std::greater_equal<>{}, 102994).indices() << std::endl;
+    // Comparands that the column type can't hold exactly aren't truncated
+    test::frame_of_reference_column<int> small(std::vector<int>{1, 2, 3, 4});
+    std::cout << "Rows < 2.5 : " << small.select(std::less<>{}, 2.5).count() << std::endl;
+}
+
+
+void test_shared_columns()
+{
+    const std::string name = "/boost_test_shared_" + std::to_string(::getpid());
+    auto writer = test::shared_columns<int, double, Point>::create(name, 1000);
+    writer.append(test::vectorize(10, std::make_tuple(48, 3.14, Point{15.2, 48.6})));
+    std::cout.flush();
+
+    const pid_t child = ::fork();
+    if(child == 0)
+    {
+        // Reader process, waits until the writer published every row
+        auto reader = test::shared_columns<int, double, Point>::attach(name);
+        while(reader.size() < 20)
+            ::usleep(1000);
+        const auto points = test::get_span<Point>(reader);
+        const double sum = reader.read([&](std::size_t rows)
+                                       {
+                                           double s = 0;
+                                           for(std::size_t i = 0; i < rows; ++i)
+                                               s += points[i].y;
+                                           return s;
+                                       });
+        std::cout << "Reader sees " << reader.size() << " rows, y sum : " << sum << std::endl;
+        std::_Exit(test::get_span<int>(reader)[19] == 87 ? 0 : 1);
+    }
+
+    writer.update(0, 48, 3.14, Point{15.2, -0.47});
+    writer.append(test::vectorize(9, std::make_tuple(48, 3.14, Point{15.2, 48.6})));
+    writer.push_back(87, 2.71, Point{1.0, 2.0});
+
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    std::cout << "Reader exit status : " << WEXITSTATUS(status) << std::endl;
+
+    // Rows past the published ones are left alone
+    std::cout << "Update of row " << writer.size() << " : " << std::boolalpha
+              << writer.update(writer.size(), 0, 0., Point{0., 0.}) << std::endl;
+}
+
+
+void test_versioned_columns()
+{
+    std::tuple<int, const char*, double> t(48, "foo", 3.14);
+    test::versioned_columns<int, const char*, double> columns(test::vectorize(2, t));
+
+    auto before = columns.snapshot();
+    {
+        auto transaction = columns.write();
+        test::get_vector<int>(transaction).push_back(87);
+        test::get_vector<const char*>(transaction).clear();
+        test::get_vector<double>(transaction).set(0, -0.47);
+        transaction.commit();
+    }
+    auto after = columns.snapshot();
+
+    // The first snapshot still sees the version it was taken on
+    std::cout << "Before : " << test::get_vector<int>(before).size() << " ints, "
+              << test::get_vector<const char*>(before).size() << " strings, "
+              << test::get_vector<double>(before)[0] << std::endl;
+    std::cout << "After : " << test::get_vector<int>(after).size() << " ints, "
+              << test::get_vector<const char*>(after).size() << " strings, "
+              << test::get_vector<double>(after)[0] << std::endl;
+
+    // Readers scan consistent versions while the writer appends
+    std::thread reader([&columns]
+    {
+        for(int i = 0; i < 100; ++i)
+        {
+            auto s = columns.snapshot();
+            const auto ints = test::get_vector<int>(s);
+            const auto doubles = test::get_vector<double>(s);
+            if(ints.size() != doubles.size() + 1)
+                std::cout << "Inconsistent snapshot" << std::endl;
+        }
+    });
+    for(int i = 0; i < 100; ++i)
+    {
+        auto transaction = columns.write();
+        transaction.append(test::vectorize(100, t));
+        transaction.commit();
+    }
+    reader.join();
+
+    auto last = columns.snapshot();
+    long sum = 0;
+    test::get_vector<int>(last).for_each_chunk([&sum](const int* data, std::size_t count)
+    {
+        for(std::size_t i = 0; i < count; ++i)
+            sum += data[i];
+    });
+    std::cout << "Final sum : " << sum << std::endl;
+
+    // More live snapshots than a block of slots holds
+    std::vector<test::column_snapshot<int, const char*, double>> held;
+    for(int i = 0; i < 150; ++i)
+        held.push_back(columns.snapshot());
+    {
+        auto transaction = columns.write();
+        test::get_vector<int>(transaction).clear();
+        transaction.commit();
+    }
+    std::cout << "Held snapshots : " << held.size() << ", rows " << test::get_vector<int>(held.back()).size()
+              << ", now " << test::get_vector<int>(columns.snapshot()).size() << std::endl;
+}
+
+
+void test_dynamic_table()
+{
+    // Schema as it could be read from a configuration file
+    std::vector<test::column_spec> schema;
+    for(auto [name, type] : {std::pair<const char*, const char*>{"id", "int32"}, {"price", "double"},
+                             {"quantity", "int64"}, {"label", "string"}})
+        schema.push_back({name, test::parse_column_type(type)});
+
+    test::dynamic_table table(schema, 4);
+    auto& prices = test::get_vector<double>(table, "price");
+    for(std::size_t i = 0; i < prices.size(); ++i)
+        prices[i] = 0.5 * static_cast<double>(i);
+    test::get_vector<std::string>(table, "label")[0] = "first";
+
+    try
+    {
+        test::get_vector<float>(table, "price");
+    }
+    catch(const std::invalid_argument& e)
+    {
+        std::cout << "Checked cast : " << e.what() << std::endl;
+    }
+
+    // One dispatch per column, the loop is the one of a std::vector<T>
+    test::for_each_column(table, [](const test::dynamic_column& column, const auto& v)
+    {
+        std::cout << column.name() << " (" << test::to_string(column.type()) << ") : " << v << std::endl;
+    });
+    const double sum = test::dispatch_arithmetic<double>(table.column("price"), [](const auto& v)
+    {
+        double s = 0;
+        for(auto e : v)
+            s += e;
+        return s;
+    });
+    std::cout << "Sum of prices : " << sum << std::endl;
+
+    // From the compile-time layout
+    std::tuple<int, double> t(48, 3.14);
+    auto from_tuple = test::make_dynamic_table(test::vectorize(2, t), {"id", "value"});
+    std::cout << "Columns : " << from_tuple.column_count() << ", " << test::get_vector<double>(from_tuple, 1) << std::endl;
+}
+
+
+void test_safe_float()
+{
+    using namespace test::literal;
+
+    // Literals convert to safe_float
+    test::safe_float<float> half = 0.5_sf;
+    test::safe_float<double, test::unchecked_policy> quarter = 0.25_sd;
+    static_assert(std::is_same_v<decltype(quarter * quarter), test::safe_float<double, test::unchecked_policy>>,
+                  "Problem");
+    std::cout << "half * half : " << half * half << ", quarter / quarter : " << quarter / quarter << std::endl;
+
+    const auto check = [](const char* what, auto&& operation)
+    {
+        try
+        {
+            operation();
+            std::cout << what << " : ok" << std::endl;
+        }
+        catch(const test::safe_float_error& e)
+        {
+            std::cout << what << " : " << e.what() << std::endl;
+        }
+    };
+
+    test::safe_float<float> big = 3e38f;
+    check("Overflow", [&]{ return big * big; });
+    check("Underflow", [&]{ return test::safe_float<float>(1e-30f) * test::safe_float<float>(1e-30f); });
+    // Tiny but exact results aren't underflows, as with FE_UNDERFLOW
+    constexpr double tiny = std::numeric_limits<double>::min();
+    check("Exact tiny", [&]{ return test::safe_float<double>(tiny) - test::safe_float<double>(tiny / 2); });
+    check("Divided by infinity", [&]{ return 1. / test::safe_float<double>(std::numeric_limits<double>::infinity()); });
+    test::safe_float<float> infinity = std::numeric_limits<float>::infinity();
+    check("NaN", [&]{ return infinity - infinity; });
+    using exact_policy = test::check_policy<test::safe_float_checks::all>;
+    check("Inexact", [&]{ return test::safe_float<double, exact_policy>(1.) / 3.; });
+    check("Exact", [&]{ return test::safe_float<double, exact_policy>(1.) / 0.125_sd; });
+
+    // Batch operations on columns, flags are tested once per block
+    std::tuple<double, float> t(3.14, 1e30f);
+    auto tv = test::vectorize(5000, t);
+    std::vector<double> doubled;
+    test::checked_add(test::get_vector<double>(tv), test::get_vector<double>(tv), doubled);
+    std::cout << "Column sum : " << test::checked_sum(doubled) << std::endl;
+    check("Column overflow", [&]{ test::checked_scale(test::get_vector<float>(tv), 1e10f); });
+
+    // Division by zero is reported the same way on scalars and columns
+    check("Division by zero", [&]{ return test::safe_float<double>(1.) / 0.; });
+    std::vector<double> quotients;
+    check("Column division by zero", [&]{ test::checked_divide(std::vector<double>{1., 2.}, std::vector<double>{4., 0.},
+                                                               quotients); });
+}
+
+
+void test_read_columns()
+{
+    const std::string path = "read_columns_test_" + std::to_string(::getpid()) + ".csv";
+    {
+        std::ofstream file(path);
+        file << "id,name,weight\n";
+        for(int i = 0; i < 1000; ++i)
+            file << i << ",item" << i % 3 << "," << (i % 2 ? "0.5" : "0x1p-3") << "\r\n";
+    }
+
+    // Tiny chunks to go through the carry-over of partial lines
+    test::read_options options;
+    options.header = true;
+    options.validate_pow_of_0_5 = true;
+    options.chunk_size = 4096;
+    auto tv = test::read_columns<int, std::string, double>(path, options);
+    std::cout << "Read " << test::get_vector<int>(tv).size() << " rows, last : "
+              << test::get_row(tv, test::get_vector<int>(tv).size() - 1) << std::endl;
+
+    {
+        std::ofstream file(path, std::ios::app);
+        file << "1000,item1,0.3\n";
+    }
+    try
+    {
+        test::read_columns<int, std::string, double>(path, options);
+    }
+    catch(const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+    std::remove(path.c_str());
+}
+
+
+void test_column_aggregates()
+{
+    auto tv = test::vectorize(5, std::make_tuple(1, 2.));
+    test::observed_column<int> column(test::get_vector<int>(tv));
+    auto& sum = column.attach<test::sum_observer<int, long>>();
+    auto& low = column.attach<test::min_observer<int>>();
+    auto& high = column.attach<test::max_observer<int>>();
+    auto& even = column.attach<test::count_observer<int, bool(*)(const int&)>>([](const int& v){ return v % 2 == 0; });
+
+    for(int i = 0; i < 100; ++i)
+        column.push_back(i);
+    column.set(0, -5);
+    column.erase(50);
+    column.erase_unordered(10);
+    for(int i = 0; i < 60; ++i)
+        column.pop_back();
+    std::cout << test::get_vector<int>(tv) << std::endl;
+    std::cout << "Sum " << sum.value() << ", min " << *low.value() << ", max " << *high.value()
+              << ", even " << even.value() << std::endl;
+
+    // Erasing everything goes through the renumbering of the slots
+    while(column.size() > 0)
+        column.erase(0);
+    std::cout << "Empty : sum " << sum.value() << ", has min " << low.value().has_value() << std::endl;
+}
+
+
+namespace
+{
+    struct price;
+    struct tax;
+    struct quantity;
+}
+
+void test_named_columns()
+{
+    // Two double columns, get_vector<double> couldn't tell them apart
+    auto tv = test::vectorize(3, std::make_tuple(test::named<price>(10.), test::named<tax>(0.2),
+                                                 test::named<quantity>(4)));
+    test::get_column<tax>(tv)[1] = 0.5;
+    test::get_column<price>(tv).push_back(12.);
+    static_assert(std::is_same_v<decltype(test::get_column<tax>(tv)), test::named_vector<tax, double>&>);
+
+    const auto& ctv = tv;
+    std::cout << test::get_column<price>(ctv) << ' ' << test::get_column<tax>(ctv) << ' '
+              << test::get_column<quantity>(ctv) << std::endl;
+    std::cout << test::get_row(tv, 1) << std::endl;
+}
+
+
+void test_vectorize_generate()
+{
+    auto rows = test::vectorize_generate(4, [](std::size_t i){ return std::make_tuple(int(i), i * 0.5, char('a' + i)); });
+    std::cout << rows << std::endl;
+
+    auto columns = test::vectorize_generate(5, std::make_tuple([](std::size_t i){ return test::named<price>(10. + i); },
+                                                               [](std::size_t i){ return test::named<tax>(0.1 * i); }));
+    std::cout << test::get_column<price>(columns) << ' ' << test::get_column<tax>(columns) << std::endl;
+
+    // Same values whatever the number of threads
+    auto square = [](std::size_t i){ return double(i) * double(i); };
+    auto parallel = test::vectorize_generate(1 << 16, std::make_tuple(square), 4);
+    auto sequential = test::vectorize_generate(1 << 16, std::make_tuple(square));
+    std::cout << "Parallel fill matches : " << (parallel == sequential) << std::endl;
+
+    // Types without default constructor are appended, even when threads are asked for
+    struct label
+    {
+        explicit label(std::size_t i) : id(i) {}
+        std::size_t id;
+    };
+    auto labels = test::vectorize_generate(1 << 16, [](std::size_t i){ return std::make_tuple(label(i), int(i)); }, 4);
+    std::cout << "Last label : " << std::get<0>(labels).back().id << std::endl;
+}
@@ -8,4 +8,28 @@ void test_vectorize();
 
 void test_get_vector();
 
+void test_column_index();
+
+void test_filter();
+
+void test_group_by();
+
+void test_column_encoding();
+
+void test_shared_columns();
+
+void test_versioned_columns();
+
+void test_dynamic_table();
+
+void test_safe_float();
+
+void test_read_columns();
+
+void test_column_aggregates();
+
+void test_named_columns();
+
+void test_vectorize_generate();
+
 #endif //TEST_CPP17_HPP
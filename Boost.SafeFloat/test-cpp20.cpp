@@ -0,0 +1,92 @@
+#include "test-cpp20.hpp"
+#include "pipeline-cpp20.hpp"
+#include "generate-cpp17.hpp"
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+
+void test_pipeline()
+{
+    using batch = test::column_batch<int, double>;
+    constexpr std::size_t N = 100000;
+    const auto tv = test::vectorize_generate(N, [](std::size_t i){ return std::make_tuple(int(i), i * 0.5); });
+
+    // ingest -> filter -> aggregate, at most 2 batches waiting between two stages
+    test::thread_pool pool(4);
+    test::channel<batch> raw(pool, 2);
+    test::channel<batch> kept(pool, 2);
+    double sum = 0;
+    std::size_t rows = 0;
+    {
+        test::pipeline p(pool);
+        p.add(test::send_batches(tv, 1024, raw));
+        p.add(test::transform_batches(raw, kept, [](batch b)
+        {
+            batch result;
+            for(std::size_t i = 0; i < std::get<0>(b).size(); ++i)
+                if(std::get<0>(b)[i] % 3 == 0)
+                {
+                    std::get<0>(result).push_back(std::get<0>(b)[i]);
+                    std::get<1>(result).push_back(std::get<1>(b)[i]);
+                }
+            return result;
+        }));
+        p.add(test::consume_batches(kept, [&](batch b)
+        {
+            rows += std::get<0>(b).size();
+            sum = std::accumulate(std::get<1>(b).begin(), std::get<1>(b).end(), sum);
+        }));
+        p.wait();
+    }
+    std::cout << "Kept " << rows << " rows, sum " << sum << std::endl;
+
+    // Fan-out then fan-in : two stages share the batches of raw2, kept2 closes when both are done
+    test::channel<batch> raw2(pool, 2);
+    test::channel<batch> kept2(pool, 2);
+    test::column_batch<int, double> result;
+    {
+        test::pipeline p(pool);
+        p.add(test::send_batches(tv, 1024, raw2));
+        for(int copy = 0; copy < 2; ++copy)
+            p.add(test::transform_batches(raw2, kept2, [](batch b)
+            {
+                for(auto& x : std::get<1>(b))
+                    x *= 2;
+                return b;
+            }));
+        p.add(test::receive_batches(kept2, result));
+        p.wait();
+    }
+    std::cout << "Fan-out rows : " << std::get<0>(result).size() << " of " << N
+              << (std::get<0>(result).size() == N ? " ok" : " lost") << std::endl;
+
+    // A failing sink stops the source through the channel and its exception is rethrown
+    test::channel<batch> in(pool, 1);
+    test::pipeline p(pool);
+    p.add(test::send_batches(tv, 16, in));
+    p.add(test::consume_batches(in, [](batch){ throw std::runtime_error("Sink failed"); }));
+    try
+    {
+        p.wait();
+    }
+    catch(const std::runtime_error& e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+}
+
+
+void test_string_column_names()
+{
+    using namespace test::literal;
+
+    // Two double columns told apart by their string names
+    auto tv = test::vectorize(3, std::make_tuple(test::named<"price"_col>(10.), test::named<"tax"_col>(0.2)));
+    test::get_column<"tax"_col>(tv)[1] = 0.5;
+    static_assert(std::is_same_v<decltype(test::get_column<"price"_col>(tv)),
+                                 test::named_vector<decltype("price"_col), double>&>);
+    static_assert(decltype("price"_col)::name == "price");
+    std::cout << "price : " << test::get_column<"price"_col>(tv)[1]
+              << ", tax : " << test::get_column<"tax"_col>(tv)[1] << std::endl;
+}
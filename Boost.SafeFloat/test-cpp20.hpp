@@ -0,0 +1,9 @@
+#ifndef TEST_CPP20_HPP
+#define TEST_CPP20_HPP
+
+
+void test_pipeline();
+
+void test_string_column_names();
+
+#endif //TEST_CPP20_HPP
@@ -0,0 +1,528 @@
+#ifndef VERSIONED_COLUMNS_CPP17_HPP
+#define VERSIONED_COLUMNS_CPP17_HPP
+
+#include "competency-test-cpp17.hpp"
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+
+namespace test
+{
+    /*
+     * Versioned tuple of vectors giving snapshot isolation to readers while a writer mutates it.
+     * Every column is split in chunks of a fixed number of elements. A version is an immutable table
+     * of chunk pointers : a writer transaction copies that table, clones (copy-on-write) only
+     * the chunks it modifies and commit() publishes the new version with one atomic store.
+     * Readers take snapshots, which is a few atomic operations, and see a consistent version
+     * for as long as they keep it, without ever blocking the writer.
+     * Old versions and replaced chunks are reclaimed with epochs : readers announce the epoch
+     * they started in and the writer only frees what was retired before the oldest of them.
+     * Readers announce their epoch in slots, allocated by blocks of 64 : there is no limit on
+     * the number of live snapshots, a new block is chained when every slot is taken and the
+     * blocks are only freed with the columns.
+     * Several writers are serialized by a mutex held by the transaction.
+     */
+    template<typename... Ts>
+    class versioned_columns;
+
+    namespace detail
+    {
+        constexpr std::size_t version_chunk_size = 4096;
+        constexpr std::size_t snapshot_block_size = 64;
+
+        // Epochs announced by the readers, a slot holding 0 is free
+        struct snapshot_slots
+        {
+            snapshot_slots()
+            {
+                for(auto& slot : slots)
+                    slot.store(0, std::memory_order_relaxed);
+            }
+
+            std::atomic<std::uint64_t> slots[snapshot_block_size];
+            std::atomic<snapshot_slots*> next{nullptr};
+        };
+
+        template<typename T>
+        struct column_chunks
+        {
+            std::vector<std::vector<T>*> chunks;
+            std::size_t size = 0;
+        };
+
+        template<typename... Ts>
+        struct column_version
+        {
+            std::tuple<column_chunks<Ts>...> columns;
+        };
+
+        // Something freed once no reader can see it anymore
+        struct retired_object
+        {
+            std::uint64_t epoch;
+            void* object;
+            void (*deleter)(void*);
+        };
+
+        template<typename U>
+        retired_object make_retired(std::uint64_t epoch, U* object)
+        {
+            return {epoch, object, [](void* p){ delete static_cast<U*>(p); }};
+        }
+    }
+
+
+    // Read-only view of one column of a version
+    template<typename T>
+    class chunked_view
+    {
+    public:
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            iterator() = default;
+
+            iterator(const detail::column_chunks<T>* column, std::size_t row)
+                : column_(column), row_(row)
+            {}
+
+            reference operator*() const
+            {
+                return (*column_->chunks[row_ / detail::version_chunk_size])[row_ % detail::version_chunk_size];
+            }
+
+            pointer operator->() const
+            {
+                return &**this;
+            }
+
+            iterator& operator++()
+            {
+                ++row_;
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                iterator old = *this;
+                ++row_;
+                return old;
+            }
+
+            friend bool operator==(const iterator& lhs, const iterator& rhs)
+            {
+                return lhs.row_ == rhs.row_;
+            }
+
+            friend bool operator!=(const iterator& lhs, const iterator& rhs)
+            {
+                return lhs.row_ != rhs.row_;
+            }
+
+        private:
+            const detail::column_chunks<T>* column_ = nullptr;
+            std::size_t row_ = 0;
+        };
+
+        explicit chunked_view(const detail::column_chunks<T>& column)
+            : column_(&column)
+        {}
+
+        std::size_t size() const
+        {
+            return column_->size;
+        }
+
+        bool empty() const
+        {
+            return column_->size == 0;
+        }
+
+        const T& operator[](std::size_t row) const
+        {
+            return (*column_->chunks[row / detail::version_chunk_size])[row % detail::version_chunk_size];
+        }
+
+        iterator begin() const
+        {
+            return iterator(column_, 0);
+        }
+
+        iterator end() const
+        {
+            return iterator(column_, column_->size);
+        }
+
+        // Call f(data, count) for every chunk, the fast way to scan a column
+        template<typename F>
+        void for_each_chunk(F&& f) const
+        {
+            for(const auto* chunk : column_->chunks)
+                f(chunk->data(), chunk->size());
+        }
+
+    private:
+        const detail::column_chunks<T>* column_;
+    };
+
+
+    // Consistent read-only view of every column, keeps its version alive until destroyed
+    template<typename... Ts>
+    class column_snapshot
+    {
+    public:
+        column_snapshot(const column_snapshot&) = delete;
+        column_snapshot& operator=(const column_snapshot&) = delete;
+
+        column_snapshot(column_snapshot&& other) noexcept
+            : slot_(other.slot_), version_(other.version_)
+        {
+            other.slot_ = nullptr;
+        }
+
+        ~column_snapshot()
+        {
+            if(slot_)
+                slot_->store(0, std::memory_order_release);
+        }
+
+        template<typename T>
+        chunked_view<T> column() const
+        {
+            return chunked_view<T>(std::get<detail::column_chunks<T>>(version_->columns));
+        }
+
+    private:
+        friend class versioned_columns<Ts...>;
+
+        column_snapshot(std::atomic<std::uint64_t>* slot, const detail::column_version<Ts...>* version)
+            : slot_(slot), version_(version)
+        {}
+
+        std::atomic<std::uint64_t>* slot_;
+        const detail::column_version<Ts...>* version_;
+    };
+
+
+    // Mutable access to one column inside a transaction
+    template<typename T>
+    class column_writer
+    {
+    public:
+        column_writer(detail::column_chunks<T>& column, std::vector<bool>& owned,
+                      std::vector<std::vector<T>*>& replaced)
+            : column_(&column), owned_(&owned), replaced_(&replaced)
+        {}
+
+        std::size_t size() const
+        {
+            return column_->size;
+        }
+
+        const T& operator[](std::size_t row) const
+        {
+            return (*column_->chunks[row / detail::version_chunk_size])[row % detail::version_chunk_size];
+        }
+
+        void set(std::size_t row, const T& value)
+        {
+            own(row / detail::version_chunk_size)[row % detail::version_chunk_size] = value;
+        }
+
+        void push_back(const T& value)
+        {
+            auto& chunks = column_->chunks;
+            if(chunks.empty() or chunks.back()->size() == detail::version_chunk_size)
+            {
+                auto* chunk = new std::vector<T>();
+                chunk->reserve(detail::version_chunk_size);
+                chunks.push_back(chunk);
+                owned_->push_back(true);
+            }
+            own(chunks.size() - 1).push_back(value);
+            ++column_->size;
+        }
+
+        void clear()
+        {
+            for(std::size_t i = 0; i < column_->chunks.size(); ++i)
+                drop(i);
+            column_->chunks.clear();
+            owned_->clear();
+            column_->size = 0;
+        }
+
+    private:
+        // Clone the chunk the first time the transaction modifies it
+        std::vector<T>& own(std::size_t i)
+        {
+            auto& chunk = column_->chunks[i];
+            if(!(*owned_)[i])
+            {
+                auto* copy = new std::vector<T>();
+                copy->reserve(detail::version_chunk_size);
+                copy->assign(chunk->begin(), chunk->end());
+                replaced_->push_back(chunk);
+                chunk = copy;
+                (*owned_)[i] = true;
+            }
+            return *chunk;
+        }
+
+        // Chunks created by the transaction were never seen by readers, they can go right away
+        void drop(std::size_t i)
+        {
+            if((*owned_)[i])
+                delete column_->chunks[i];
+            else
+                replaced_->push_back(column_->chunks[i]);
+        }
+
+        detail::column_chunks<T>* column_;
+        std::vector<bool>* owned_;
+        std::vector<std::vector<T>*>* replaced_;
+    };
+
+
+    // Batch of modifications published atomically by commit(), discarded if not committed
+    template<typename... Ts>
+    class column_transaction
+    {
+    public:
+        column_transaction(const column_transaction&) = delete;
+        column_transaction& operator=(const column_transaction&) = delete;
+        column_transaction(column_transaction&&) = default;
+
+        ~column_transaction()
+        {
+            if(version_)
+                discard(std::index_sequence_for<Ts...>{});
+        }
+
+        template<typename T>
+        column_writer<T> column()
+        {
+            constexpr std::size_t I = index<T>();
+            static_assert(I < sizeof...(Ts), "Type not in columns");
+            return column_writer<T>(std::get<I>(version_->columns), owned_[I],
+                                    std::get<std::vector<std::vector<T>*>>(replaced_));
+        }
+
+        // Append the rows of a tuple of vectors as created by vectorize
+        void append(const std::tuple<std::vector<Ts>...>& tv)
+        {
+            std::apply([this](const auto&... columns){ (append_column(columns), ...); }, tv);
+        }
+
+        void commit()
+        {
+            owner_->publish(version_.release(), replaced_);
+            lock_.unlock();
+        }
+
+    private:
+        friend class versioned_columns<Ts...>;
+
+        template<typename T>
+        static constexpr std::size_t index()
+        {
+            constexpr bool matches[] = {std::is_same_v<T, Ts>...};
+            for(std::size_t i = 0; i < sizeof...(Ts); ++i)
+                if(matches[i])
+                    return i;
+            return sizeof...(Ts);
+        }
+
+        column_transaction(versioned_columns<Ts...>* owner, std::unique_lock<std::mutex> lock,
+                           const detail::column_version<Ts...>& current)
+            : owner_(owner), lock_(std::move(lock)),
+              version_(std::make_unique<detail::column_version<Ts...>>(current))
+        {
+            std::size_t i = 0;
+            std::apply([&](const auto&... columns){ ((owned_[i++].assign(columns.chunks.size(), false)), ...); },
+                       version_->columns);
+        }
+
+        template<typename T>
+        void append_column(const std::vector<T>& values)
+        {
+            auto writer = column<T>();
+            for(const auto& v : values)
+                writer.push_back(v);
+        }
+
+        template<std::size_t... I>
+        void discard(std::index_sequence<I...>)
+        {
+            auto discard_column = [](auto& column, const std::vector<bool>& owned)
+            {
+                for(std::size_t i = 0; i < column.chunks.size(); ++i)
+                    if(owned[i])
+                        delete column.chunks[i];
+            };
+            (discard_column(std::get<I>(version_->columns), owned_[I]), ...);
+        }
+
+        versioned_columns<Ts...>* owner_;
+        std::unique_lock<std::mutex> lock_;
+        std::unique_ptr<detail::column_version<Ts...>> version_;
+        std::vector<bool> owned_[sizeof...(Ts)];
+        std::tuple<std::vector<std::vector<Ts>*>...> replaced_;
+    };
+
+
+    template<typename... Ts>
+    class versioned_columns
+    {
+    public:
+        versioned_columns()
+            : current_(new detail::column_version<Ts...>())
+        {}
+
+        // Start from the content of a tuple of vectors
+        explicit versioned_columns(const std::tuple<std::vector<Ts>...>& tv)
+            : versioned_columns()
+        {
+            auto transaction = write();
+            transaction.append(tv);
+            transaction.commit();
+        }
+
+        versioned_columns(const versioned_columns&) = delete;
+        versioned_columns& operator=(const versioned_columns&) = delete;
+
+        // No snapshot may outlive the columns
+        ~versioned_columns()
+        {
+            for(auto& r : retired_)
+                r.deleter(r.object);
+            for(auto* block = slots_.next.load(std::memory_order_relaxed); block != nullptr;)
+                delete std::exchange(block, block->next.load(std::memory_order_relaxed));
+            auto* version = current_.load(std::memory_order_relaxed);
+            std::apply([](auto&... columns){ (delete_chunks(columns), ...); }, version->columns);
+            delete version;
+        }
+
+        // Lock-free, allocates a block of slots when every slot is taken
+        column_snapshot<Ts...> snapshot() const
+        {
+            for(auto* block = &slots_;;)
+            {
+                for(auto& slot : block->slots)
+                {
+                    std::uint64_t expected = 0;
+                    if(slot.load(std::memory_order_relaxed) == 0
+                       and slot.compare_exchange_strong(expected, epoch_.load()))
+                        return column_snapshot<Ts...>(&slot, current_.load());
+                }
+
+                auto* next = block->next.load();
+                if(next == nullptr)
+                {
+                    // Another reader may chain a block first, then its block is used
+                    auto* added = new detail::snapshot_slots();
+                    if(block->next.compare_exchange_strong(next, added))
+                        next = added;
+                    else
+                        delete added;
+                }
+                block = next;
+            }
+        }
+
+        column_transaction<Ts...> write()
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex_);
+            return column_transaction<Ts...>(this, std::move(lock), *current_.load(std::memory_order_relaxed));
+        }
+
+    private:
+        friend class column_transaction<Ts...>;
+
+        template<typename T>
+        static void delete_chunks(detail::column_chunks<T>& column)
+        {
+            for(auto* chunk : column.chunks)
+                delete chunk;
+        }
+
+        // Called with the writer mutex held
+        void publish(detail::column_version<Ts...>* version,
+                     std::tuple<std::vector<std::vector<Ts>*>...>& replaced)
+        {
+            auto* old = current_.exchange(version);
+            // Readers that announced this epoch or an older one may still see the old version
+            const std::uint64_t epoch = epoch_.fetch_add(1);
+            retired_.push_back(detail::make_retired(epoch, old));
+            std::apply([&](auto&... chunks)
+                       {
+                           auto retire = [&](auto& list)
+                           {
+                               for(auto* chunk : list)
+                                   retired_.push_back(detail::make_retired(epoch, chunk));
+                           };
+                           (retire(chunks), ...);
+                       }, replaced);
+            reclaim();
+        }
+
+        void reclaim()
+        {
+            std::uint64_t oldest = epoch_.load();
+            for(const auto* block = &slots_; block != nullptr; block = block->next.load())
+                for(auto& slot : block->slots)
+                {
+                    const std::uint64_t e = slot.load();
+                    if(e != 0 and e < oldest)
+                        oldest = e;
+                }
+
+            std::size_t kept = 0;
+            for(auto& r : retired_)
+            {
+                if(r.epoch < oldest)
+                    r.deleter(r.object);
+                else
+                    retired_[kept++] = r;
+            }
+            retired_.resize(kept);
+        }
+
+        std::atomic<detail::column_version<Ts...>*> current_;
+        // Epochs start at 1, a slot holding 0 is free
+        std::atomic<std::uint64_t> epoch_{1};
+        mutable detail::snapshot_slots slots_;
+        std::mutex writer_mutex_;
+        std::vector<detail::retired_object> retired_;
+    };
+
+    // get_vector-like access to the columns of snapshots and transactions
+    template<typename T, typename... Ts>
+    chunked_view<T> get_vector(const column_snapshot<Ts...>& s)
+    {
+        return s.template column<T>();
+    }
+
+    template<typename T, typename... Ts>
+    chunked_view<T> get_vector(column_snapshot<Ts...>& s)
+    {
+        return s.template column<T>();
+    }
+
+    template<typename T, typename... Ts>
+    column_writer<T> get_vector(column_transaction<Ts...>& t)
+    {
+        return t.template column<T>();
+    }
+}
+#endif //VERSIONED_COLUMNS_CPP17_HPP
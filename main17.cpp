@@ -5,6 +5,18 @@ int main()
     test_floating_literal();
     test_vectorize();
     test_get_vector();
+    test_column_index();
+    test_filter();
+    test_group_by();
+    test_column_encoding();
+    test_shared_columns();
+    test_versioned_columns();
+    test_dynamic_table();
+    test_safe_float();
+    test_read_columns();
+    test_column_aggregates();
+    test_named_columns();
+    test_vectorize_generate();
 
     return 0;
 }
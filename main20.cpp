@@ -0,0 +1,9 @@
+#include "Boost.SafeFloat/test-cpp20.hpp" 
+
+int main()
+{    
+    test_pipeline();
+    test_string_column_names();
+
+    return 0;
+}